@@ -0,0 +1,205 @@
+/*
+ * archive.h
+ *
+ * Reads assets from the CD archive built by imagekit/tools/assetpak
+ * (cdrom/build-archive.sh). The table of contents is read once at boot;
+ * an entry is read into a heap buffer that is freed as soon as its data is
+ * in VRAM or SPU RAM, so none of it stays in main RAM. The entry indexes
+ * are in imagekit/assets.h.
+ *
+ * Packed entries (lz.h) are read into the end of the very buffer they are
+ * decoded into, far enough in for the output never to catch up with the
+ * input, so loading one takes no second buffer and no copy.
+ *
+ * Debug builds print every read as a "trace ASSETS.PAK/name" line: a TTY log
+ * of a play session is the access trace (cdrom/trace.txt) that assetpak and
+ * discbuild lay the disc out by.
+ */
+
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include "imagekit/assets.h"
+#include "lz.h"
+
+#define ARCHIVE_FILE "\\ASSETS.PAK;1"
+#define ARCHIVE_MAGIC 0x324b4150 // "PAK2"
+#define ARCHIVE_SECTOR 2048
+#define ARCHIVE_ENTRY_MAX 64
+#define ARCHIVE_RETRIES 4
+#define ARCHIVE_FREE_MAX 8 // buffers archiveFreeLater() can hold back
+
+typedef struct {
+	unsigned long magic;
+	unsigned long count;
+	unsigned long tocSectors; // sectors taken by the header and the entries
+	unsigned long reserved;
+} ArchiveHeader;
+
+typedef struct {
+	char name[16];
+	unsigned long sector; // from the start of the archive
+	unsigned long size;   // in bytes once unpacked
+	unsigned long packed; // in bytes on the disc, unpadded; archiveBufferSize() rounds it to sectors
+	unsigned long margin; // least offset of the packed data in the output buffer
+	unsigned long method; // LZ_NONE, LZ_LZSS or LZ_LZ4
+} ArchiveEntry;
+
+int archiveSector; // first sector of ASSETS.PAK on the disc
+int archiveCount;
+ArchiveEntry archiveEntries[ARCHIVE_ENTRY_MAX];
+
+// Logs a read for the access trace
+void archiveTrace(int entry) {
+	if (!DEBUG) return;
+	if (entry < 0) printf("trace ASSETS.PAK\n");
+	else printf("trace ASSETS.PAK/%.16s\n", archiveEntries[entry].name);
+}
+
+// Reads sectors sectors starting at sector (from the start of the archive)
+// and waits for them, retrying on read errors
+int archiveRead(int sector, int sectors, unsigned long *buffer) {
+	CdlLOC loc;
+	int i;
+	for (i = 0; i < ARCHIVE_RETRIES; i++) {
+		CdIntToPos(archiveSector + sector, &loc);
+		if (!CdControl(CdlSetloc, (u_char *)&loc, 0)) continue;
+		if (!CdRead(sectors, buffer, CdlModeSpeed)) continue;
+		if (CdReadSync(0, 0) == 0) return 1;
+	}
+	return 0;
+}
+
+// Finds the archive on the disc and reads its table of contents
+int archiveInit() {
+	CdlFILE file;
+	ArchiveHeader *header;
+	unsigned long *toc;
+	int size;
+
+	archiveCount = 0;
+	CdInit();
+	if (!CdSearchFile(&file, ARCHIVE_FILE)) {
+		if (DEBUG) printf("%s is not on the disc\n", ARCHIVE_FILE);
+		return 0;
+	}
+	archiveSector = CdPosToInt(&file.pos);
+	archiveTrace(-1);
+
+	toc = malloc3(ARCHIVE_SECTOR);
+	if (!toc) return 0;
+	if (!archiveRead(0, 1, toc)) {
+		free3(toc);
+		return 0;
+	}
+	header = (ArchiveHeader *)toc;
+	if (header->magic != ARCHIVE_MAGIC || header->count > ARCHIVE_ENTRY_MAX) {
+		if (DEBUG) printf("%s is not an asset archive\n", ARCHIVE_FILE);
+		free3(toc);
+		return 0;
+	}
+	if (header->tocSectors > 1) {
+		size = header->tocSectors;
+		free3(toc);
+		toc = malloc3(size * ARCHIVE_SECTOR);
+		if (!toc) return 0;
+		if (!archiveRead(0, size, toc)) {
+			free3(toc);
+			return 0;
+		}
+		header = (ArchiveHeader *)toc;
+	}
+	archiveCount = header->count;
+	memcpy(archiveEntries, header + 1, archiveCount * sizeof(ArchiveEntry));
+	free3(toc);
+	return 1;
+}
+
+// Entry index of name, or -1
+int archiveFind(char *name) {
+	int i;
+	for (i = 0; i < archiveCount; i++) {
+		if (!strncmp(archiveEntries[i].name, name, sizeof(archiveEntries[i].name))) return i;
+	}
+	return -1;
+}
+
+// Size of the buffer an entry is loaded into, and in *offset where its packed
+// sectors go (0 when it is stored as it is). CdRead always writes whole
+// sectors.
+int archiveBufferSize(int entry, int *offset) {
+	ArchiveEntry *e = &archiveEntries[entry];
+	int read = (e->packed + ARCHIVE_SECTOR - 1) / ARCHIVE_SECTOR * ARCHIVE_SECTOR;
+	int size = read;
+	if (e->method != LZ_NONE) {
+		size = read + e->margin;
+		if (size < e->size) size = e->size;
+		size = (size + 3) & ~3;
+	}
+	*offset = size - read;
+	return size;
+}
+
+// Reads an entry into a new heap buffer, unpacked, NULL when it cannot be
+// read. The buffer goes back with archiveFree() once the data has been
+// uploaded.
+unsigned char *archiveLoad(int entry, int *size) {
+	ArchiveEntry *e;
+	int offset;
+	unsigned char *data;
+
+	if (entry < 0 || entry >= archiveCount) return NULL;
+	e = &archiveEntries[entry];
+	archiveTrace(entry);
+	data = malloc3(archiveBufferSize(entry, &offset));
+	if (!data) {
+		if (DEBUG) printf("No heap left to load %s\n", e->name);
+		return NULL;
+	}
+	if (!archiveRead(e->sector, (e->packed + ARCHIVE_SECTOR - 1) / ARCHIVE_SECTOR, (unsigned long *)(data + offset))) {
+		if (DEBUG) printf("Cannot read %s\n", e->name);
+		free3(data);
+		return NULL;
+	}
+	lzDecode(e->method, data + offset, data, e->size);
+	if (size) *size = e->size;
+	return data;
+}
+
+// LoadImage() is asynchronous, wait for the GPU to be done reading the
+// buffer before it goes back to the heap
+void archiveFree(unsigned char *data) {
+	if (!data) return;
+	DrawSync(0);
+	free3(data);
+}
+
+unsigned char *archiveFreeData[ARCHIVE_FREE_MAX];  // held back for the GPU, NULL for a free slot
+unsigned long  archiveFreeDraw[ARCHIVE_FREE_MAX];  // gpuDrawDoneCount when it was held back
+
+// archiveFree() without the wait, for buffers freed while the game runs: the
+// buffer goes back to the heap in archiveFreeDone() once a DrawSync callback
+// has come after its LoadImage() was queued, the GPU queue having drained
+void archiveFreeLater(unsigned char *data) {
+	int i;
+	if (!data) return;
+	for (i = 0; i < ARCHIVE_FREE_MAX; i++) {
+		if (archiveFreeData[i]) continue;
+		archiveFreeData[i] = data;
+		archiveFreeDraw[i] = gpuDrawDoneCount;
+		return;
+	}
+	archiveFree(data); // nowhere to keep it, wait after all
+}
+
+// Once a frame: frees the held back buffers the GPU is done with
+void archiveFreeDone() {
+	int i;
+	for (i = 0; i < ARCHIVE_FREE_MAX; i++) {
+		if (!archiveFreeData[i] || archiveFreeDraw[i] == gpuDrawDoneCount) continue;
+		free3(archiveFreeData[i]);
+		archiveFreeData[i] = NULL;
+	}
+}
+
+#endif
@@ -0,0 +1,19 @@
+#!/bin/sh
+#---------------------------------------------------------------
+# NAME			- Asset archive
+# DESCRIPTION	- Converts the images and packs them, the font and the
+#				  sounds into cdrom/ASSETS.PAK, with its index in
+#				  imagekit/assets.h, each entry LZ packed when that
+#				  saves sectors. Run it before BUILD_ISO.bat.
+#---------------------------------------------------------------
+
+set -e
+cd "$(dirname "$0")/.."
+
+make -s -C imagekit/tools assetc assetpak
+./imagekit/convert-images.sh -a -t images/tim
+./imagekit/tools/assetpak -z -o cdrom/ASSETS.PAK -H imagekit/assets.h -t cdrom/trace.txt \
+	imagekit/images/tim/*.tim \
+	font=imagekit/etc/PIXELSPRITEFONT32.TIM \
+	hit_hurt=audio/Hit_Hurt2Right.VAG \
+	explode=audio/Explode1Right.VAG
@@ -0,0 +1,25 @@
+#!/bin/sh
+#---------------------------------------------------------------
+# NAME			- Disc image
+# DESCRIPTION	- Linux counterpart of BUILD_ISO.bat: packs the assets,
+#				  encodes the music and writes GAME.bin/GAME.cue into
+#				  builds/<date>, laid out in the order of trace.txt.
+#				  MAIN.EXE must already be built. Set LICENSE to a
+#				  licensee.dat to license the image for real hardware.
+#---------------------------------------------------------------
+
+set -e
+cd "$(dirname "$0")"
+
+./build-archive.sh
+./build-music.sh
+make -s -C ../imagekit/tools discbuild
+
+stamp=$(date +%Y%m%d_%H%M%S)
+mkdir -p "builds/$stamp"
+../imagekit/tools/discbuild -o "builds/$stamp/GAME" -t trace.txt ${LICENSE:+-l "$LICENSE"} \
+	SYSTEM.CNF=TOOLS/SYSTEM.txt \
+	MAIN.EXE=../MAIN.EXE \
+	ASSETS.PAK=ASSETS.PAK \
+	MUSIC.XA=MUSIC.XA
+echo "Your game has been built into builds/$stamp"
@@ -0,0 +1,16 @@
+#!/bin/sh
+#---------------------------------------------------------------
+# NAME			- Music
+# DESCRIPTION	- Encodes the music tracks to XA-ADPCM and interleaves
+#				  them into cdrom/MUSIC.XA, with the track list in
+#				  imagekit/music_tracks.h. Every track gets a channel
+#				  of its own, up to 16 at 37.8 kHz mono; tracks meant
+#				  to be switched between should be the same length.
+#---------------------------------------------------------------
+
+set -e
+cd "$(dirname "$0")/.."
+
+make -s -C imagekit/tools xaenc
+./imagekit/tools/xaenc -o cdrom/MUSIC.XA -H imagekit/music_tracks.h \
+	music=audio/musicRight.VAG
@@ -10,23 +10,53 @@
 
 #include <STDLIB.H>
 #include <STDIO.H>
+#include <STRING.H>
 #include <LIBGTE.H>
 #include <LIBGPU.H>
 #include <LIBGS.H>
 #include <LIBETC.H>
+#include <LIBAPI.H>
 #include <LIBSPU.H>
+#include <LIBCD.H>
+#include <MALLOC.H>
 #include <SYS/TYPES.H>
 #include "controller.h"
 #include "imagekit/images.h"
 
-#define OT_LENGTH 1
-#define PACKETMAX 300
+#define OT_LENGTH 6 // 1<<OT_LENGTH buckets per ordering table
+#ifndef PACKETMAX
+#define PACKETMAX 8192 // bytes of GPU packets per buffer, override at build time with -DPACKETMAX=n
+#endif
+#ifndef HEAP_SIZE
+#define HEAP_SIZE 0x80000 // bytes of heap for load buffers, override at build time with -DHEAP_SIZE=n
+#endif
+#define HEAP_END 0x801f0000 // the heap ends 64 KB below the stack top set in SYSTEM.CNF
+#define PACKET_SPRITE_SIZE 48 // worst case GsSortSprite packet (rotated/scaled POLY_FT4 + mode)
+#define SPRITE_BACKEND_GS 0  // every sprite through GsSortSprite
+#define SPRITE_BACKEND_RAW 1 // SPRT/POLY_FT4 built in place, GsSortSprite only for rotation
+#ifndef SPRITE_BACKEND
+#define SPRITE_BACKEND SPRITE_BACKEND_RAW // override at build time with -DSPRITE_BACKEND=n
+#endif
+#define SPRITE_HIDDEN 0x80000000 // GsSPRITE attribute bits
+#define SPRITE_SEMI_TRANS 0x40000000
+#define PACKET_CLEAR_SIZE 32 // kept free for the GsSortClear in gpuVSync()
 #define TYPE_LINE 0
 #define TYPE_BOX 1
 #define SCREEN_MODE_PAL 0
 #define SCREEN_MODE_NTSC 1
 #define DEBUG 0
-#define SOUND_MALLOC_MAX 10
+
+// Ordering table layers, from front (drawn last) to back (drawn first)
+#define LAYER_HUD 0
+#define LAYER_PLAYER 1
+#define LAYER_BULLETS 2
+#define LAYER_ENEMIES 3
+#define LAYER_BACKGROUND 4
+#define LAYER_COUNT 5
+
+#include "vram.h"
+#include "scratchpad.h"
+#include "sound.h"
 
 typedef struct {
 	int r;
@@ -48,34 +78,64 @@ typedef struct {
 	RECT rect;
 	RECT crect;
 	GsIMAGE tim_data;
+	Texture texture;
 	GsSPRITE sprite;
+	short trimX, trimY; // of the cropped image in the source one, see TimSprite
 } Image;
 
+typedef struct {
+	int depth;   // log2 of the number of buckets owned by the layer
+	int ysort;   // spread primitives over the buckets by screen Y
+	int reserve; // packet bytes left for more important layers before this one gets dropped
+	int base;    // first bucket, assigned by initializeOrderingTable()
+} Layer;
+
+typedef struct {
+	int used;             // packet bytes used by the previous frame
+	int peak;             // high-water mark of used since boot
+	int dropped;          // primitives dropped by the previous frame
+	int droppedTotal;     // primitives dropped since boot
+	int layerDropped[LAYER_COUNT]; // primitives dropped per layer since boot
+} PacketStats;
+
+// The depths must add up to at most 1<<OT_LENGTH buckets. When the packet area
+// runs low the layers with the biggest reserve are the first to go.
+Layer layers[LAYER_COUNT] = {
+	{ 2, 0, 0 },               // LAYER_HUD
+	{ 3, 1, 0 },               // LAYER_PLAYER
+	{ 4, 1, PACKETMAX / 8 },   // LAYER_BULLETS
+	{ 5, 1, PACKETMAX / 16 },  // LAYER_ENEMIES
+	{ 2, 0, PACKETMAX / 4 }    // LAYER_BACKGROUND
+};
+
 int 		  SCREEN_WIDTH, SCREEN_HEIGHT;
-GsOT 		  orderingTable[2];
+GsOT 		  *orderingTable; // the two headers, on the scratchpad
 GsOT_TAG  	  minorOrderingTable[2][1<<OT_LENGTH];
 PACKET 		  GPUOutputPacket[2][PACKETMAX];
 short 		  currentBuffer;
+PacketStats   packetStats;
+int 		  packetDropped;
 Color 		  systemBackgroundColor;
+volatile int  gpuBusy;     // an ordering table is being drawn, cleared by the DrawSync callback
+volatile int  frameReady;  // display() queued a frame for the next vblank
+volatile short frameBuffer; // buffer of the queued frame
+volatile unsigned long vsyncCount;
+volatile unsigned short gpuKickHsync; // root counter 1 when the last frame was kicked
+volatile unsigned short gpuHsyncs;    // hsyncs the GPU took to draw the last frame
+volatile unsigned long gpuDrawDoneCount; // DrawSync callbacks so far, see archiveFreeLater()
 SpuCommonAttr l_c_attr;
 SpuVoiceAttr  g_s_attr;
-unsigned long l_vag1_spu_addr;
 
 void audioInit() {
-	SpuInit();
-	SpuInitMalloc (SOUND_MALLOC_MAX, SPU_MALLOC_RECSIZ * (SOUND_MALLOC_MAX + 1));
+	SpuInit(); // SPU RAM is handed out by soundRamAlloc(), not SpuMalloc()
 	l_c_attr.mask = (SPU_COMMON_MVOLL | SPU_COMMON_MVOLR);
 	l_c_attr.mvol.left  = 0x3fff; // set master left volume
 	l_c_attr.mvol.right = 0x3fff; // set master right volume
 	SpuSetCommonAttr (&l_c_attr);
 }
 
-void audioTransferVagToSPU(char* sound, int sound_size, int voice_channel) {
-	SpuSetTransferMode (SpuTransByDMA); // set transfer mode to DMA
-	l_vag1_spu_addr = SpuMalloc(sound_size); // allocate SPU memory for sound 1
-	SpuSetTransferStartAddr(l_vag1_spu_addr); // set transfer starting address to malloced area
-	SpuWrite (sound + 0x30, sound_size); // perform actual transfer
-	SpuIsTransferCompleted (SPU_TRANSFER_WAIT); // wait for DMA to complete
+// Points a voice at a sample already in SPU RAM
+void audioVoiceInit(unsigned long spu_addr, int voice_channel) {
 	// mask which specific voice attributes are to be set
 	g_s_attr.mask =
 			(
@@ -99,7 +159,7 @@ void audioTransferVagToSPU(char* sound, int sound_size, int voice_channel) {
 	g_s_attr.volume.right = 0x1fff;
 
 	g_s_attr.pitch        = 0x1000;
-	g_s_attr.addr         = l_vag1_spu_addr;
+	g_s_attr.addr         = spu_addr;
 	g_s_attr.a_mode       = SPU_VOICE_LINEARIncN;
 	g_s_attr.s_mode       = SPU_VOICE_LINEARIncN;
 	g_s_attr.r_mode       = SPU_VOICE_LINEARDecN;
@@ -112,6 +172,17 @@ void audioTransferVagToSPU(char* sound, int sound_size, int voice_channel) {
 	SpuSetVoiceAttr (&g_s_attr);
 }
 
+// Queues the upload and returns straight away: sound has to stay around and
+// the voice only plays the sample once soundUploadIdle(). Returns the SPU
+// address for audioFree(), SOUND_ADDR_NONE when SPU RAM is full.
+unsigned long audioTransferVagToSPU(char* sound, int sound_size, int voice_channel) {
+	unsigned long spu_addr = soundRamAlloc(sound_size);
+	if (spu_addr == SOUND_ADDR_NONE) return spu_addr;
+	soundUpload(SOUND_NONE, spu_addr, (unsigned char *)sound + 0x30, sound_size, NULL, NULL);
+	audioVoiceInit(spu_addr, voice_channel);
+	return spu_addr;
+}
+
 void audioPlay(int voice_channel) {
 	SpuSetKey(SpuOn, voice_channel);
 }
@@ -121,54 +192,55 @@ void audioChannelConfigure() {
 }
 
 void audioFree(unsigned long sound_address) {
-	SpuFree(sound_address);
+	soundRamFree(sound_address);
 }
 
-Image createImage(unsigned char* imageData, int width, int height) {
+// A width or height of 0 takes the image's own: the cropped size for TIMs
+// from assetc, which also give the pivot and the trim offsets (read when the
+// size of the TIM data is given, see timSprite()). An image that
+// does not fit in VRAM comes back with a 0 x 0 sprite and holds no VRAM.
+Image createImage(unsigned char* imageData, int size, int width, int height) {
     // Initialize image
     Image image;
+    TimSprite *info = timSprite(imageData, size);
     GsGetTimInfo((u_long *)(imageData + 4), &image.tim_data);
 
-    // Load the image into the frame buffer
-    image.rect.x = image.tim_data.px; // tim start X coord to put image data in frame buffer
-    image.rect.y = image.tim_data.py; // tim start Y coord to put image data in frame buffer
-    image.rect.w = image.tim_data.pw; // data width
-    image.rect.h = image.tim_data.ph; // data height
-    LoadImage(&image.rect, image.tim_data.pixel);
-
-    // Load the CLUT into the frame buffer
-    image.crect.x = image.tim_data.cx; // x pos to put CLUT in frame buffer
-    image.crect.y = image.tim_data.cy; // y pos to put CLUT in frame buffer
-    image.crect.w = image.tim_data.cw; // width of CLUT
-    image.crect.h = image.tim_data.ch; // height of CLUT
-    LoadImage(&image.crect, image.tim_data.clut);
+    // Load the image and its CLUT wherever the VRAM allocator finds room
+    if (!textureLoadRows(&image.tim_data, 0, image.tim_data.ph, &image.texture)) {
+        if (DEBUG) printf("No VRAM left for a %dx%d image\n", image.tim_data.pw, image.tim_data.ph);
+        textureFree(&image.texture);
+        setRECT(&image.rect, 0, 0, 0, 0);
+        setRECT(&image.crect, 0, 0, 0, 0);
+        memset(&image.sprite, 0, sizeof(GsSPRITE));
+        image.trimX = 0;
+        image.trimY = 0;
+        return image;
+    }
+    setRECT(&image.rect, image.texture.px, image.texture.py, image.tim_data.pw, image.tim_data.ph);
+    setRECT(&image.crect, image.texture.cx, image.texture.cy, image.tim_data.cw, image.tim_data.ch);
 
     // Initialize sprite
-    image.sprite.attribute = 0x1000000; // (0x1 = 8-bit, 0x2 = 16-bit)
+    image.sprite.attribute = image.texture.mode << 24; // (0x0 = 4-bit, 0x1 = 8-bit, 0x2 = 16-bit)
     image.sprite.x = 0; // draw at x coord
     image.sprite.y = 0; // draw at y coord
-    image.sprite.w = width ? width : image.tim_data.pw * 2; // width of sprite
-    image.sprite.h = height ? height : image.tim_data.ph; // height of sprite
-
-    image.sprite.tpage = GetTPage(
-        1, // 0=4-bit, 1=8-bit, 2=16-bit
-        1, // semitransparency rate
-        image.tim_data.px, // framebuffer pixel x
-        image.tim_data.py  // framebuffer pixel y
-    );
+    image.sprite.w = width ? width : (info ? info->w : image.texture.w); // width of sprite
+    image.sprite.h = height ? height : (info ? info->h : image.texture.h); // height of sprite
+    image.sprite.tpage = image.texture.tpage;
 
     image.sprite.r = 128; // color red blend
     image.sprite.g = 128; // color green blend
     image.sprite.b = 128; // color blue blend
-    image.sprite.u = (image.tim_data.px - 320) * 2; // position within timfile for sprite
-    image.sprite.v = image.tim_data.py; // position within timfile for sprite
-    image.sprite.cx = image.tim_data.cx; // CLUT location x
-    image.sprite.cy = image.tim_data.cy; // CLUT location y
-    image.sprite.mx = 0; // rotation x coord
-    image.sprite.my = 0; // rotation y coord
+    image.sprite.u = image.texture.u; // position within the texture page
+    image.sprite.v = image.texture.v; // position within the texture page
+    image.sprite.cx = image.texture.cx; // CLUT location x
+    image.sprite.cy = image.texture.cy; // CLUT location y
+    image.sprite.mx = info ? info->pivotX : 0; // rotation x coord
+    image.sprite.my = info ? info->pivotY : 0; // rotation y coord
     image.sprite.scalex = ONE; // scale x (ONE = 100%)
     image.sprite.scaley = ONE; // scale y (ONE = 100%)
     image.sprite.rotate = 0; // rotation
+    image.trimX = info ? info->trimX : 0;
+    image.trimY = info ? info->trimY : 0;
 
     return image;
 }
@@ -217,9 +289,9 @@ Line moveLine(Line line, int x1, int y1, int x2, int y2) {
 
 Box moveBox(Box box, int x1, int y1) {
 	int currentWidth = box.line[0].line.x1 - box.line[0].line.x0;
-	int currentHeight = box.line[2].line.y1 - box.line[2].line.y1;
+	int currentHeight = box.line[2].line.y1 - box.line[2].line.y0;
 	int x2 = x1 + currentWidth;
-	int y2 = y1 + currentWidth;
+	int y2 = y1 + currentHeight;
 	box.line[0] = moveLine(box.line[0], x1, y1, x2, y1);
 	box.line[1] = moveLine(box.line[1], x1, y2, x2, y2);
 	box.line[2] = moveLine(box.line[2], x1, y1, x1, y2);
@@ -228,24 +300,205 @@ Box moveBox(Box box, int x1, int y1) {
 }
 
 
-void drawLine(Line line) {
-	DrawPrim(&line.line);
+
+void sprite_create(unsigned char* imageData, int width, int height, Image* image) {
+    *image = createImage(imageData, 0, width, height); // uncropped
+}
+
+// Returns the ordering table bucket for a primitive on a layer. Y-sorted layers
+// put primitives lower on the screen (bigger y) in front of the ones above them.
+unsigned short layerPriority(int layer, int y) {
+	Layer *l = &layers[layer];
+	if (!l->ysort) return l->base;
+	if (y < 0) y = 0;
+	if (y > 255) y = 255;
+	return l->base + ((255 - y) >> (8 - l->depth));
+}
+
+// Bytes of the current buffer's packet area already handed out this frame
+int packetUsed() {
+	return GsGetWorkBase() - GPUOutputPacket[currentBuffer];
+}
+
+// Checks that a primitive of size bytes fits in the packet area. Returns 0 and
+// counts the primitive as dropped when it would eat into the space kept for
+// more important layers (or overrun the buffer).
+int packetReserve(int layer, int size) {
+	if (packetUsed() + size + layers[layer].reserve + PACKET_CLEAR_SIZE <= PACKETMAX) return 1;
+	packetDropped++;
+	packetStats.layerDropped[layer]++;
+	return 0;
+}
+
+// Batched packetReserve: returns how many of count primitives of size bytes
+// fit, and counts the rest as dropped
+int packetReserveBatch(int layer, int size, int count) {
+	int fit = (PACKETMAX - PACKET_CLEAR_SIZE - layers[layer].reserve - packetUsed()) / size;
+	if (fit < 0) fit = 0;
+	if (fit >= count) return count;
+	packetDropped += count - fit;
+	packetStats.layerDropped[layer] += count - fit;
+	return fit;
+}
+
+// Closes the frame's packet accounting, called once the frame is complete
+void packetEndFrame() {
+	packetStats.used = packetUsed();
+	if (packetStats.used > packetStats.peak) packetStats.peak = packetStats.used;
+	packetStats.dropped = packetDropped;
+	packetStats.droppedTotal += packetDropped;
+	packetDropped = 0;
+	if (DEBUG && packetStats.dropped) printf("Packet area full: %d bytes used, %d primitives dropped\n", packetStats.used, packetStats.dropped);
+}
+
+// Copies the line into the packet area and links it into the ordering table,
+// so it goes out with the rest of the frame in GsDrawOt
+void drawLine(Line *line, int layer) {
+	LINE_F2 *packet;
+	currentBuffer = GsGetActiveBuff();
+	if (!packetReserve(layer, sizeof(LINE_F2))) return;
+	packet = (LINE_F2 *)GsGetWorkBase();
+	*packet = line->line;
+	AddPrim(orderingTable[currentBuffer].org + layerPriority(layer, packet->y1), packet);
+	GsSetWorkBase((PACKET *)(packet + 1));
 }
 
-void drawBox(Box box) {
+void drawBox(Box *box, int layer) {
 	int i;
 	for(i = 0; i < 4; i++) {
-		DrawPrim(&box.line[i].line);
+		drawLine(&box->line[i], layer);
 	}
 }
 
-void sprite_create(unsigned char* imageData, int width, int height, Image* image) {
-    *image = createImage(imageData, width, height);
+// Builds a LINE_F2 straight in the packet area, with no Line kept around
+void sortLine(Color color, int x1, int y1, int x2, int y2, int layer) {
+	LINE_F2 *packet;
+	currentBuffer = GsGetActiveBuff();
+	if (!packetReserve(layer, sizeof(LINE_F2))) return;
+	packet = (LINE_F2 *)GsGetWorkBase();
+	SetLineF2(packet);
+	setRGB0(packet, color.r, color.g, color.b);
+	setXY2(packet, x1, y1, x2, y2);
+	AddPrim(orderingTable[currentBuffer].org + layerPriority(layer, y2), packet);
+	GsSetWorkBase((PACKET *)(packet + 1));
+}
+
+void drawTile(Color color, int x, int y, int w, int h, int layer) {
+	TILE *packet;
+	currentBuffer = GsGetActiveBuff();
+	if (!packetReserve(layer, sizeof(TILE))) return;
+	packet = (TILE *)GsGetWorkBase();
+	SetTile(packet);
+	setRGB0(packet, color.r, color.g, color.b);
+	setXY0(packet, x, y);
+	setWH(packet, w, h);
+	AddPrim(orderingTable[currentBuffer].org + layerPriority(layer, y + h), packet);
+	GsSetWorkBase((PACKET *)(packet + 1));
+}
+
+// Outline of a w x h rectangle, generated at draw time
+void drawRect(Color color, int x, int y, int w, int h, int layer) {
+	sortLine(color, x, y, x + w, y, layer);
+	sortLine(color, x, y + h, x + w, y + h, layer);
+	sortLine(color, x, y, x, y + h, layer);
+	sortLine(color, x + w, y, x + w, y + h, layer);
+}
+
+#if SPRITE_BACKEND == SPRITE_BACKEND_RAW
+// An unscaled sprite: SPRT_16, SPRT_8 or SPRT by size, and the DR_TPAGE that
+// switches to its texture page. AddPrim puts primitives at the head of the
+// bucket, so the sprite goes in first to be drawn after its DR_TPAGE.
+void sortSpriteFast(GsSPRITE *sprite, int layer) {
+	GsOT_TAG *bucket = orderingTable[currentBuffer].org + layerPriority(layer, sprite->y + sprite->h);
+	unsigned short clut = getClut(sprite->cx, sprite->cy);
+	SPRT *p;
+	SPRT_16 *p16;
+	SPRT_8 *p8;
+	DR_TPAGE *tpage;
+
+	if (!packetReserve(layer, sizeof(SPRT) + sizeof(DR_TPAGE))) return;
+	if (sprite->w == 16 && sprite->h == 16) {
+		p16 = (SPRT_16 *)GsGetWorkBase();
+		SetSprt16(p16);
+		setSemiTrans(p16, sprite->attribute & SPRITE_SEMI_TRANS);
+		setRGB0(p16, sprite->r, sprite->g, sprite->b);
+		setXY0(p16, sprite->x, sprite->y);
+		setUV0(p16, sprite->u, sprite->v);
+		p16->clut = clut;
+		AddPrim(bucket, p16);
+		tpage = (DR_TPAGE *)(p16 + 1);
+	} else if (sprite->w == 8 && sprite->h == 8) {
+		p8 = (SPRT_8 *)GsGetWorkBase();
+		SetSprt8(p8);
+		setSemiTrans(p8, sprite->attribute & SPRITE_SEMI_TRANS);
+		setRGB0(p8, sprite->r, sprite->g, sprite->b);
+		setXY0(p8, sprite->x, sprite->y);
+		setUV0(p8, sprite->u, sprite->v);
+		p8->clut = clut;
+		AddPrim(bucket, p8);
+		tpage = (DR_TPAGE *)(p8 + 1);
+	} else {
+		p = (SPRT *)GsGetWorkBase();
+		SetSprt(p);
+		setSemiTrans(p, sprite->attribute & SPRITE_SEMI_TRANS);
+		setRGB0(p, sprite->r, sprite->g, sprite->b);
+		setXY0(p, sprite->x, sprite->y);
+		setUV0(p, sprite->u, sprite->v);
+		setWH(p, sprite->w, sprite->h);
+		p->clut = clut;
+		AddPrim(bucket, p);
+		tpage = (DR_TPAGE *)(p + 1);
+	}
+	SetDrawTPage(tpage, 1, 0, sprite->tpage);
+	AddPrim(bucket, tpage);
+	GsSetWorkBase((PACKET *)(tpage + 1));
+}
+
+// A scaled but unrotated sprite: one POLY_FT4, which carries its own texture
+// page, scaled about mx, my. A negative scale mirrors it.
+void sortSpriteScaled(GsSPRITE *sprite, int layer) {
+	POLY_FT4 *p;
+	int x0, y0, x1, y1, u1, v1;
+
+	if (!packetReserve(layer, sizeof(POLY_FT4))) return;
+	x0 = sprite->x + sprite->mx - (sprite->mx * sprite->scalex >> 12);
+	y0 = sprite->y + sprite->my - (sprite->my * sprite->scaley >> 12);
+	x1 = x0 + (sprite->w * sprite->scalex >> 12);
+	y1 = y0 + (sprite->h * sprite->scaley >> 12);
+	u1 = sprite->u + sprite->w;
+	v1 = sprite->v + sprite->h;
+	if (u1 > 255) u1 = 255;
+	if (v1 > 255) v1 = 255;
+	p = (POLY_FT4 *)GsGetWorkBase();
+	SetPolyFT4(p);
+	setSemiTrans(p, sprite->attribute & SPRITE_SEMI_TRANS);
+	setRGB0(p, sprite->r, sprite->g, sprite->b);
+	setXY4(p, x0, y0, x1, y0, x0, y1, x1, y1);
+	setUV4(p, sprite->u, sprite->v, u1, sprite->v, sprite->u, v1, u1, v1);
+	p->tpage = sprite->tpage;
+	p->clut = getClut(sprite->cx, sprite->cy);
+	AddPrim(orderingTable[currentBuffer].org + layerPriority(layer, y0 > y1 ? y0 : y1), p);
+	GsSetWorkBase((PACKET *)(p + 1));
 }
+#endif
 
-void drawImage(Image image) {
+// With the raw backend only rotated sprites take the generic GsSortSprite
+void drawSprite(GsSPRITE *sprite, int layer) {
 	currentBuffer = GsGetActiveBuff();
-	GsSortSprite(&image.sprite, &orderingTable[currentBuffer], 0);
+#if SPRITE_BACKEND == SPRITE_BACKEND_RAW
+	if (sprite->attribute & SPRITE_HIDDEN) return;
+	if (!sprite->rotate) {
+		if (sprite->scalex == ONE && sprite->scaley == ONE) sortSpriteFast(sprite, layer);
+		else sortSpriteScaled(sprite, layer);
+		return;
+	}
+#endif
+	if (!packetReserve(layer, PACKET_SPRITE_SIZE)) return;
+	GsSortSprite(sprite, &orderingTable[currentBuffer], layerPriority(layer, sprite->y + sprite->h));
+}
+
+void drawImage(Image image, int layer) {
+	drawSprite(&image.sprite, layer);
 }
 
 //Set the screen mode to either SCREEN_MODE_PAL or SCREEN_MODE_NTSC
@@ -274,8 +527,17 @@ void setBackgroundColor(Color color) {
 }
 
 void initializeOrderingTable(){
+    int i, base = 0;
+    if (!orderingTable) orderingTable = scratchAlloc(2 * sizeof(GsOT)); // read on every AddPrim
     GsClearOt(0,0,&orderingTable[GsGetActiveBuff()]);
 
+    // hand out the buckets to the layers, front to back
+    for (i = 0; i < LAYER_COUNT; i++) {
+        layers[i].base = base;
+        base += 1 << layers[i].depth;
+    }
+    if (DEBUG && base > (1 << OT_LENGTH)) printf("Layers need %d buckets, ordering table has %d\n", base, 1 << OT_LENGTH);
+
     // initialise the ordering tables
     orderingTable[0].length = OT_LENGTH;
     orderingTable[1].length = OT_LENGTH;
@@ -294,6 +556,33 @@ void clearVRAM() {
     return;
 }
 
+// DrawSync callback, the GPU finished the ordering table kicked by gpuVSync()
+// and whatever LoadImage()s were queued with it
+void gpuDrawDone() {
+	gpuHsyncs = (GetRCnt(RCntCNT1) - gpuKickHsync) & 0xffff;
+	gpuBusy = 0;
+	gpuDrawDoneCount++;
+}
+
+// VSync callback. Once the previous frame is fully drawn, swaps the buffers
+// and kicks the frame queued by display(). A frame that is not ready yet, or a
+// GPU still busy, just waits for the next vblank.
+// The clear has to come after GsSwapDispBuff(), which sets the drawing area it
+// clears, so it is sorted here rather than in display(). It goes into the
+// queued frame's packet area at the work base display() left behind, into the
+// PACKET_CLEAR_SIZE bytes packetReserve() keeps free; the main loop does not
+// touch that buffer again until frameReady drops (clearDisplay()).
+void gpuVSync() {
+	vsyncCount++;
+	if (!frameReady || gpuBusy) return;
+	GsSwapDispBuff();
+	GsSortClear(systemBackgroundColor.r, systemBackgroundColor.g, systemBackgroundColor.b, &orderingTable[frameBuffer]);
+	gpuBusy = 1;
+	gpuKickHsync = GetRCnt(RCntCNT1);
+	GsDrawOt(&orderingTable[frameBuffer]);
+	frameReady = 0;
+}
+
 void initializeScreen() {
 	if (*(char *)0xbfc7ff52=='E') setScreenMode(SCREEN_MODE_PAL);
    	else setScreenMode(SCREEN_MODE_NTSC);
@@ -301,30 +590,49 @@ void initializeScreen() {
 	SetDispMask(1);
 	ResetGraph(0);
 	clearVRAM();
+	vramInit();
+	vramReserve(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT * 2); // both display buffers
 	GsInitGraph(SCREEN_WIDTH, SCREEN_HEIGHT, GsINTER|GsOFSGPU, 1, 0); //Set up interlation..
 	GsDefDispBuff(0, 0, 0, SCREEN_HEIGHT);	//..and double buffering.
 	systemBackgroundColor = createColor(0, 0, 255);
 	initializeOrderingTable();
+	DrawSyncCallback(gpuDrawDone);
+	VSyncCallback(gpuVSync);
+}
+
+// The heap sits at the top of RAM, below the stack, and holds the temporary
+// buffers assets are read into (archive.h)
+void initializeHeap() {
+	InitHeap3((unsigned long *)(HEAP_END - HEAP_SIZE), HEAP_SIZE);
 }
 
 void initializeDebugFont() {
 	FntLoad(960, 256);
+	vramReserve(960, 256, 64, 256); // debug font texture and CLUT
 	SetDumpFnt(FntOpen(5, 20, 320, 240, 0, 512)); //Sets the dumped font for use with FntPrint();
 }
 
 void clearDisplay() {
+	// the other buffer only frees up once the vblank callback has taken the
+	// queued frame, so this only waits when the CPU is a whole frame ahead;
+	// that can only happen at a vblank, so sleep until the next one
+	while (frameReady) VSync(0);
 	currentBuffer = GsGetActiveBuff();
 	FntFlush(-1);
 	GsSetWorkBase((PACKET*)GPUOutputPacket[currentBuffer]);
 	GsClearOt(0, 0, &orderingTable[currentBuffer]);
 }
 
+// Hands the finished ordering table to the vblank callback and returns
+// straight away, the CPU moves on to the next frame while it is drawn
 void display() {
 	currentBuffer = GsGetActiveBuff();
-	DrawSync(0);
-	VSync(0);
-	GsSwapDispBuff();
-	GsSortClear(systemBackgroundColor.r, systemBackgroundColor.g, systemBackgroundColor.b, &orderingTable[currentBuffer]);
-	GsDrawOt(&orderingTable[currentBuffer]);
+	packetEndFrame();
+	scratchCheck();
+	// gpuVSync() sorts the clear behind the last packet, see there
+	if (DEBUG && frameReady) printf("display() called twice without clearDisplay()\n");
+	if (DEBUG && packetStats.used + PACKET_CLEAR_SIZE > PACKETMAX) printf("Packet area full: no room left for the clear\n");
+	frameBuffer = currentBuffer;
+	frameReady = 1;
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,126 @@
+#ifndef ENTITY_H
+#define ENTITY_H
+
+// Entity store. Every field lives in its own fixed-size array indexed by the
+// entity id, so the update and draw loops walk packed int16 arrays instead of
+// copying Image structs around. Sprites are shared: an entity only keeps a
+// handle into spriteTable. The positions, read by every update, collision
+// and draw loop, live on the scratchpad.
+
+#define ENTITY_MAX 128
+#define SPRITE_MAX 16
+#define ENTITY_NONE -1
+
+#define ENTITY_ACTIVE 0x01  // slot in use, moved by entityUpdate()
+#define ENTITY_VISIBLE 0x02 // drawn by entityDraw()
+
+// Collision groups for entityCollide, tested against query masks in grid.h
+#define COLLIDE_PLAYER 0x01
+#define COLLIDE_ENEMY 0x02
+#define COLLIDE_PLAYER_BULLET 0x04
+#define COLLIDE_ENEMY_BULLET 0x08
+
+short *entityX;                 // ENTITY_MAX each, on the scratchpad
+short *entityY;
+short entityVX[ENTITY_MAX];
+short entityVY[ENTITY_MAX];
+short entityW[ENTITY_MAX];      // bounding box width
+short entityH[ENTITY_MAX];      // bounding box height
+short entitySprite[ENTITY_MAX]; // handle into spriteTable
+short entityLayer[ENTITY_MAX];  // ordering table layer (LAYER_*)
+short entityFlags[ENTITY_MAX];
+short entityCollide[ENTITY_MAX]; // COLLIDE_* groups, 0 keeps it out of the collision grid
+short entityNext[ENTITY_MAX];   // free list link
+int   entityFree;               // first free slot, ENTITY_NONE when full
+int   entityHigh;               // one past the highest slot ever used
+int   entityCount;
+
+GsSPRITE spriteTable[SPRITE_MAX];
+short    spriteTrimX[SPRITE_MAX]; // where the cropped sprite sits in its source image
+short    spriteTrimY[SPRITE_MAX];
+int      spriteCount;
+
+void entityInit() {
+	int i;
+	if (!entityX) {
+		entityX = scratchAlloc(ENTITY_MAX * sizeof(short));
+		entityY = scratchAlloc(ENTITY_MAX * sizeof(short));
+	}
+	for (i = 0; i < ENTITY_MAX; i++) {
+		entityFlags[i] = 0;
+		entityNext[i] = i + 1;
+	}
+	entityNext[ENTITY_MAX - 1] = ENTITY_NONE;
+	entityFree = 0;
+	entityHigh = 0;
+	entityCount = 0;
+}
+
+// Loads a TIM of size bytes into VRAM and returns its sprite handle, or
+// ENTITY_NONE when the table is full or the image does not fit in VRAM. A
+// width and height of 0 keep the image's cropped size.
+int spriteLoad(unsigned char* imageData, int size, int width, int height) {
+	Image image;
+	if (spriteCount == SPRITE_MAX) return ENTITY_NONE;
+	image = createImage(imageData, size, width, height);
+	if (!image.sprite.w || !image.sprite.h) return ENTITY_NONE;
+	spriteTable[spriteCount] = image.sprite;
+	spriteTrimX[spriteCount] = image.trimX;
+	spriteTrimY[spriteCount] = image.trimY;
+	return spriteCount++;
+}
+
+// Takes a slot off the free list. x, y is the top left of the uncropped source
+// image, the entity sits where its cropped sprite does. The bounding box
+// starts out as the sprite size. Returns ENTITY_NONE for a sprite that failed
+// to load (ENTITY_NONE from spriteLoad()) or with the pool full.
+int entitySpawn(int sprite, int layer, int x, int y) {
+	int id = entityFree;
+	if (sprite < 0 || sprite >= spriteCount) return ENTITY_NONE;
+	if (id == ENTITY_NONE) return ENTITY_NONE;
+	entityFree = entityNext[id];
+	entityX[id] = x + spriteTrimX[sprite];
+	entityY[id] = y + spriteTrimY[sprite];
+	entityVX[id] = 0;
+	entityVY[id] = 0;
+	entityW[id] = spriteTable[sprite].w;
+	entityH[id] = spriteTable[sprite].h;
+	entitySprite[id] = sprite;
+	entityLayer[id] = layer;
+	entityFlags[id] = ENTITY_ACTIVE | ENTITY_VISIBLE;
+	entityCollide[id] = 0;
+	if (id >= entityHigh) entityHigh = id + 1;
+	entityCount++;
+	return id;
+}
+
+void entityDespawn(int id) {
+	if (!(entityFlags[id] & ENTITY_ACTIVE)) return;
+	entityFlags[id] = 0;
+	entityNext[id] = entityFree;
+	entityFree = id;
+	entityCount--;
+}
+
+void entityUpdate() {
+	int i;
+	for (i = 0; i < entityHigh; i++) {
+		if (!(entityFlags[i] & ENTITY_ACTIVE)) continue;
+		entityX[i] += entityVX[i];
+		entityY[i] += entityVY[i];
+	}
+}
+
+void entityDraw() {
+	int i;
+	GsSPRITE *sprite;
+	for (i = 0; i < entityHigh; i++) {
+		if (!(entityFlags[i] & ENTITY_VISIBLE)) continue;
+		sprite = &spriteTable[entitySprite[i]];
+		sprite->x = entityX[i];
+		sprite->y = entityY[i];
+		drawSprite(sprite, entityLayer[i]);
+	}
+}
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef GRID_H
+#define GRID_H
+
+// Broad-phase collision. Every frame gridBuild() bins the colliding entities
+// into a uniform screen-space grid; queries then only run the AABB test
+// against entities sharing a cell with the box being tested. Entities are
+// filtered by their entityCollide bits (COLLIDE_*) against a mask. The cell
+// heads, walked by every query, live on the scratchpad.
+
+#define GRID_CELL_SHIFT 5 // 32x32 pixel cells
+#define GRID_COLS 10      // covers 320 pixels
+#define GRID_ROWS 8       // covers 256 pixels (PAL), NTSC uses 240 of it
+#define GRID_CELLS (GRID_COLS * GRID_ROWS)
+#define GRID_ENTRIES (ENTITY_MAX * 4) // an entity no bigger than a cell touches at most 4 cells
+
+short *gridHead;                // first entry of each cell, ENTITY_NONE when empty
+short gridEntity[GRID_ENTRIES];
+short gridNext[GRID_ENTRIES];
+int   gridEntryCount;
+int   gridOverflow;             // entries that did not fit last frame
+short gridStamp[ENTITY_MAX];    // last query that tested each entity
+short gridQueryId;
+
+void gridInit() {
+	if (!gridHead) gridHead = scratchAlloc(GRID_CELLS * sizeof(short));
+}
+
+int gridColumn(int x) {
+	x >>= GRID_CELL_SHIFT;
+	if (x < 0) return 0;
+	if (x >= GRID_COLS) return GRID_COLS - 1;
+	return x;
+}
+
+int gridRow(int y) {
+	y >>= GRID_CELL_SHIFT;
+	if (y < 0) return 0;
+	if (y >= GRID_ROWS) return GRID_ROWS - 1;
+	return y;
+}
+
+int gridOverlap(int x, int y, int w, int h, int id) {
+	return x < entityX[id] + entityW[id] && entityX[id] < x + w &&
+	       y < entityY[id] + entityH[id] && entityY[id] < y + h;
+}
+
+void gridBuild() {
+	int i, cx, cy, x0, x1, y0, y1, cell;
+	for (i = 0; i < GRID_CELLS; i++) gridHead[i] = ENTITY_NONE;
+	gridEntryCount = 0;
+	gridOverflow = 0;
+	for (i = 0; i < entityHigh; i++) {
+		if (!(entityFlags[i] & ENTITY_ACTIVE) || !entityCollide[i]) continue;
+		x0 = gridColumn(entityX[i]);
+		x1 = gridColumn(entityX[i] + entityW[i] - 1);
+		y0 = gridRow(entityY[i]);
+		y1 = gridRow(entityY[i] + entityH[i] - 1);
+		for (cy = y0; cy <= y1; cy++) {
+			for (cx = x0; cx <= x1; cx++) {
+				if (gridEntryCount == GRID_ENTRIES) {
+					gridOverflow++;
+					continue;
+				}
+				cell = cy * GRID_COLS + cx;
+				gridEntity[gridEntryCount] = i;
+				gridNext[gridEntryCount] = gridHead[cell];
+				gridHead[cell] = gridEntryCount++;
+			}
+		}
+	}
+}
+
+// Returns the first entity matching mask whose bounding box overlaps the box,
+// or ENTITY_NONE. Entities spanning several cells are only tested once.
+int gridQuery(int x, int y, int w, int h, int mask) {
+	int cx, cy, x0, x1, y1, e, id;
+	if (++gridQueryId == 0x7fff) {
+		for (e = 0; e < ENTITY_MAX; e++) gridStamp[e] = 0;
+		gridQueryId = 1;
+	}
+	x0 = gridColumn(x);
+	x1 = gridColumn(x + w - 1);
+	y1 = gridRow(y + h - 1);
+	for (cy = gridRow(y); cy <= y1; cy++) {
+		for (cx = x0; cx <= x1; cx++) {
+			for (e = gridHead[cy * GRID_COLS + cx]; e != ENTITY_NONE; e = gridNext[e]) {
+				id = gridEntity[e];
+				if (!(entityCollide[id] & mask) || gridStamp[id] == gridQueryId) continue;
+				gridStamp[id] = gridQueryId;
+				if (gridOverlap(x, y, w, h, id)) return id;
+			}
+		}
+	}
+	return ENTITY_NONE;
+}
+
+// Calls hit(a, b) for every overlapping pair with a in maskA and b in maskB.
+// A pair sharing several cells is only reported from the cell holding the
+// top-left corner of the overlap.
+void gridCollide(int maskA, int maskB, void (*hit)(int a, int b)) {
+	int cell, ea, eb, a, b, ox, oy;
+	for (cell = 0; cell < GRID_CELLS; cell++) {
+		for (ea = gridHead[cell]; ea != ENTITY_NONE; ea = gridNext[ea]) {
+			a = gridEntity[ea];
+			if (!(entityCollide[a] & maskA)) continue;
+			for (eb = gridHead[cell]; eb != ENTITY_NONE; eb = gridNext[eb]) {
+				b = gridEntity[eb];
+				if (a == b || !(entityCollide[b] & maskB)) continue;
+				if (!gridOverlap(entityX[a], entityY[a], entityW[a], entityH[a], b)) continue;
+				ox = entityX[a] > entityX[b] ? entityX[a] : entityX[b];
+				oy = entityY[a] > entityY[b] ? entityY[a] : entityY[b];
+				if (gridRow(oy) * GRID_COLS + gridColumn(ox) != cell) continue;
+				hit(a, b);
+			}
+		}
+	}
+}
+
+#endif
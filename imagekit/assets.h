@@ -0,0 +1,7 @@
+// Asset archive index, generated by imagekit/tools/assetpak. Do not edit.
+#define ASSET_COUNT 5
+#define ASSET_ENEMY 0 // 1344 bytes
+#define ASSET_SHIP 1 // 948 bytes
+#define ASSET_FONT 2 // 67104 bytes
+#define ASSET_HIT_HURT 3 // 4160 bytes
+#define ASSET_EXPLODE 4 // 13840 bytes
@@ -0,0 +1,13 @@
+#!/bin/sh
+#---------------------------------------------------------------
+# NAME			- Images to header
+# DESCRIPTION	- Converts the images folder to images.h and vram_layout.h
+#				  with the native asset compiler, only changed images
+#				  are converted again
+#---------------------------------------------------------------
+
+set -e
+cd "$(dirname "$0")"
+
+make -s -C tools assetc
+./tools/assetc -o images.h -l vram_layout.h "$@" images
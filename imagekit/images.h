@@ -1,183 +1,24 @@
 unsigned short img_enemy_gpu_x = 320; 
 unsigned short img_enemy_gpu_y = 0; 
-unsigned short img_ship_gpu_x = 336; 
+unsigned short img_enemy_clut_x = 320; 
+unsigned short img_enemy_clut_y = 511; 
+unsigned short img_ship_gpu_x = 333; 
 unsigned short img_ship_gpu_y = 0; 
+unsigned short img_ship_clut_x = 320; 
+unsigned short img_ship_clut_y = 511; 
 unsigned short img_enemy_width = 32; 
 unsigned short img_enemy_height = 32; 
+unsigned short img_enemy_trim_x = 3; 
+unsigned short img_enemy_trim_y = 2; 
+unsigned short img_enemy_trim_width = 26; 
+unsigned short img_enemy_trim_height = 30; 
+short img_enemy_pivot_x = 13; 
+short img_enemy_pivot_y = 14; 
 unsigned short img_ship_width = 18; 
 unsigned short img_ship_height = 24; 
-unsigned char img_enemy[] = {
-0x10,0x00,0x00,0x00,0x09,0x00,0x00,0x00,0x0c,0x02,0x00,0x00,0x40,0x01,0xe0,
-0x01,0x00,0x01,0x01,0x00,0x00,0x00,0x88,0x5d,0xf1,0x6e,0xbd,0x77,0x2e,0x56,
-0x37,0x77,0xc2,0x20,0x8a,0x45,0xc8,0x28,0xcc,0x38,0xd7,0x5d,0x8c,0x28,0x7f,
-0x6e,0x19,0x4d,0x84,0x18,0x08,0x31,0xe6,0x7f,0x20,0x56,0xfb,0x7f,0xd1,0x4d,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x0c,0x04,0x00,0x00,0x40,0x01,0x00,0x00,
-0x10,0x00,0x20,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x01,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x02,
-0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x01,0x02,0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x00,
-0x00,0x00,0x01,0x03,0x02,0x01,0x00,0x00,0x00,0x01,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x01,0x00,0x00,0x00,0x01,0x02,0x03,0x01,0x00,0x00,0x00,0x01,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x01,0x02,0x00,0x00,0x01,0x02,0x03,0x03,0x02,0x01,0x00,0x00,0x02,0x01,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x02,0x02,0x00,0x00,0x02,0x03,0x03,0x03,0x03,0x02,0x00,0x00,
-0x02,0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x01,0x03,0x03,0x01,0x00,0x00,0x03,0x03,0x03,0x03,0x00,
-0x00,0x01,0x03,0x03,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x02,0x03,0x03,0x02,0x00,0x00,0x04,0x05,0x04,
-0x06,0x00,0x00,0x02,0x03,0x03,0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x04,0x05,0x04,0x06,0x00,0x00,0x07,
-0x07,0x07,0x06,0x00,0x00,0x04,0x05,0x04,0x06,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x07,0x07,0x07,0x06,0x00,
-0x04,0x05,0x05,0x04,0x04,0x07,0x00,0x07,0x07,0x07,0x06,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x04,0x05,0x05,0x04,
-0x04,0x07,0x08,0x07,0x07,0x07,0x06,0x08,0x04,0x05,0x05,0x04,0x04,0x07,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x07,0x07,0x06,0x08,0x08,0x04,0x07,0x07,0x06,0x08,0x08,0x07,0x07,0x06,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x04,0x07,0x06,0x08,0x08,0x04,0x07,0x07,0x06,0x08,0x08,0x04,0x07,
-0x06,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x04,0x07,0x06,0x09,0x08,0x04,0x07,0x07,0x06,0x08,0x09,
-0x04,0x07,0x06,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x0a,0x0a,0x0a,0x0a,0x09,0x09,0x06,0x06,0x06,0x06,
-0x09,0x09,0x08,0x08,0x08,0x08,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x0b,0x0b,0x0a,0x0c,0x0c,0x0c,0x0a,0x09,0x09,0x09,
-0x09,0x09,0x09,0x08,0x0a,0x0a,0x0a,0x08,0x0b,0x0b,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x0b,0x0d,0x0b,0x0a,0x08,0x0c,0x08,0x0c,0x0a,
-0x0a,0x0a,0x08,0x08,0x08,0x0a,0x0e,0x0a,0x0e,0x08,0x0b,0x0d,0x0b,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x08,0x08,0x0c,0x0d,0x0f,0x0a,0x08,0x0c,0x08,
-0x0c,0x0c,0x0c,0x0c,0x0a,0x0a,0x0a,0x0a,0x0e,0x0a,0x0e,0x08,0x0b,0x0b,0x0b,
-0x0e,0x0e,0x00,0x00,0x00,0x00,0x00,0x00,0x08,0x08,0x0d,0x08,0x0a,0x0a,0x0c,
-0x0c,0x0c,0x0c,0x10,0x10,0x10,0x11,0x11,0x11,0x0a,0x0a,0x0a,0x0a,0x0a,0x08,
-0x0e,0x0b,0x0e,0x0e,0x00,0x00,0x00,0x00,0x00,0x00,0x08,0x08,0x08,0x08,0x08,
-0x08,0x0a,0x0c,0x0c,0x11,0x10,0x12,0x10,0x10,0x11,0x11,0x11,0x0a,0x0a,0x0a,
-0x0e,0x0e,0x0e,0x0e,0x0e,0x0e,0x00,0x00,0x00,0x00,0x00,0x00,0x08,0x08,0x08,
-0x08,0x09,0x09,0x08,0x0a,0x0c,0x11,0x10,0x10,0x10,0x10,0x11,0x11,0x11,0x0a,
-0x0a,0x0e,0x08,0x08,0x0e,0x0e,0x0e,0x0e,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x08,0x08,0x08,0x09,0x09,0x09,0x08,0x0c,0x0c,0x11,0x10,0x10,0x11,0x11,0x11,
-0x0a,0x0a,0x0e,0x08,0x09,0x08,0x08,0x0e,0x0e,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x08,0x09,0x09,0x13,0x09,0x09,0x08,0x0a,0x0c,0x0c,0x11,0x11,0x11,
-0x11,0x0a,0x0a,0x0a,0x0e,0x09,0x08,0x08,0x08,0x08,0x0e,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x08,0x09,0x13,0x09,0x09,0x09,0x08,0x0a,0x0c,0x0c,
-0x0c,0x0a,0x0a,0x0a,0x0a,0x0e,0x08,0x09,0x08,0x08,0x08,0x0e,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x08,0x09,0x09,0x13,0x09,0x09,0x08,0x00,
-0x0a,0x0c,0x0c,0x0a,0x0a,0x0a,0x0e,0x0e,0x08,0x08,0x08,0x08,0x08,0x0e,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x08,0x09,0x09,0x09,0x08,
-0x00,0x00,0x00,0x0a,0x0a,0x0e,0x0e,0x0e,0x00,0x00,0x0e,0x08,0x08,0x08,0x0e,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x08,0x08,
-0x08,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x0e,0x0e,
-0x0e,0x00,0x00,0x00,0x00,0x00,0x00,0x00
-};
-unsigned char img_ship[] = {
-0x10,0x00,0x00,0x00,0x09,0x00,0x00,0x00,0x0c,0x02,0x00,0x00,0x40,0x01,0xdf,
-0x01,0x00,0x01,0x01,0x00,0x00,0x00,0x91,0x31,0xce,0x10,0x0e,0x11,0x8e,0x08,
-0x4e,0x29,0x8c,0x08,0x4e,0x21,0xb3,0x46,0xb5,0x46,0xd1,0x31,0xca,0x18,0x48,
-0x08,0x4c,0x21,0x91,0x08,0x11,0x21,0xae,0x56,0xee,0x7f,0xea,0x7f,0x24,0x6f,
-0x82,0x45,0xc6,0x18,0x95,0x08,0x2c,0x3a,0xfb,0x7f,0xb1,0x77,0xe2,0x66,0x20,
-0x56,0x44,0x31,0xd1,0x39,0xec,0x7f,0xb3,0x77,0xea,0x66,0x8a,0x08,0x97,0x08,
-0x91,0x29,0xec,0x56,0xac,0x4e,0xca,0x45,0x86,0x39,0x84,0x39,0x06,0x21,0x17,
-0x11,0x3d,0x32,0x7b,0x3a,0x53,0x21,0x93,0x08,0x57,0x19,0xfd,0x46,0xbf,0x5f,
-0x7d,0x3a,0x13,0x11,0xd5,0x10,0x15,0x11,0x3f,0x4f,0xdd,0x21,0x59,0x19,0xce,
-0x08,0xd7,0x10,0x55,0x19,0xd5,0x29,0x35,0x32,0x0e,0x19,0x4c,0x29,0x88,0x18,
-0x88,0x10,0x0a,0x21,0x0a,0x19,0xc8,0x10,0x0a,0x29,0x0c,0x21,0x0e,0x21,0x31,
-0x46,0x2e,0x56,0x48,0x45,0x08,0x21,0x71,0x56,0xb3,0x56,0x2c,0x46,0x4a,0x29,
-0x08,0x31,0xae,0x6e,0x8a,0x39,0xb1,0x5e,0xf3,0x66,0x6e,0x56,0x8a,0x45,0xcc,
-0x4d,0xb1,0x6e,0x35,0x77,0x37,0x6f,0xb3,0x6e,0xf3,0x6e,0xf5,0x6e,0x77,0x77,
-0xb3,0x5e,0x7b,0x77,0xbd,0x77,0x73,0x5e,0x71,0x6e,0xb5,0x6e,0x31,0x56,0x6e,
-0x66,0x33,0x6f,0x2c,0x5e,0xf1,0x6e,0x6c,0x66,0xce,0x39,0x8c,0x39,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xbc,0x01,0x00,0x00,0x50,0x01,0x00,0x00,
-0x09,0x00,0x18,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x02,0x03,0x04,0x05,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x06,0x07,0x08,
-0x09,0x0a,0x0b,0x0c,0x0d,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x0e,
-0x0f,0x10,0x11,0x12,0x13,0x14,0x15,0x0c,0x0d,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x04,0x16,0x17,0x11,0x18,0x19,0x1a,0x1b,0x1c,0x0c,0x0c,0x1d,0x00,0x00,
-0x00,0x00,0x00,0x01,0x0e,0x16,0x17,0x1e,0x1f,0x20,0x1b,0x1b,0x1c,0x0c,0x21,
-0x05,0x00,0x00,0x00,0x00,0x01,0x0e,0x22,0x16,0x23,0x24,0x25,0x26,0x27,0x28,
-0x29,0x21,0x04,0x04,0x05,0x00,0x00,0x00,0x04,0x16,0x16,0x16,0x16,0x2a,0x2b,
-0x2c,0x2d,0x06,0x0c,0x21,0x04,0x0e,0x04,0x1d,0x00,0x00,0x06,0x2e,0x2e,0x2e,
-0x2e,0x2f,0x30,0x31,0x32,0x33,0x0c,0x0c,0x0c,0x21,0x21,0x1d,0x00,0x00,0x06,
-0x2e,0x34,0x35,0x34,0x2f,0x30,0x36,0x37,0x33,0x21,0x04,0x21,0x0c,0x0c,0x1d,
-0x00,0x00,0x06,0x2e,0x35,0x38,0x34,0x2f,0x30,0x36,0x37,0x33,0x39,0x3a,0x04,
-0x0c,0x0c,0x1d,0x00,0x00,0x06,0x2e,0x0e,0x0e,0x04,0x3b,0x30,0x36,0x37,0x33,
-0x21,0x04,0x21,0x0c,0x0c,0x1d,0x00,0x00,0x06,0x2e,0x04,0x0c,0x0c,0x02,0x3c,
-0x3d,0x3b,0x02,0x0c,0x0c,0x0c,0x0c,0x0c,0x1d,0x00,0x00,0x06,0x0e,0x3e,0x3f,
-0x40,0x41,0x42,0x0d,0x43,0x44,0x40,0x45,0x46,0x0c,0x0c,0x1d,0x00,0x00,0x47,
-0x3e,0x48,0x49,0x4a,0x4b,0x4c,0x4d,0x4e,0x4f,0x50,0x49,0x00,0x46,0x0b,0x00,
-0x00,0x00,0x00,0x00,0x00,0x51,0x49,0x52,0x53,0x54,0x55,0x56,0x57,0x58,0x4c,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x59,0x5a,0x5b,0x59,0x59,0x59,0x5c,
-0x5d,0x5e,0x5f,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x5d,0x60,0x60,0x61,
-0x61,0x61,0x60,0x60,0x5a,0x62,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x63,
-0x5e,0x59,0x60,0x60,0x61,0x5e,0x59,0x64,0x65,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x66,0x59,0x59,0x5e,0x67,0x60,0x5e,0x67,0x58,0x65,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x68,0x51,0x67,0x59,0x69,0x67,0x59,0x51,0x68,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x68,0x51,0x69,0x69,0x69,0x51,
-0x68,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x68,0x6a,
-0x51,0x51,0x68,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x49,0x68,0x68,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00,0x00,0x00,0x00,0x00,0x00,0x6b,0x6c,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-0x00
-};
+unsigned short img_ship_trim_x = 1; 
+unsigned short img_ship_trim_y = 0; 
+unsigned short img_ship_trim_width = 16; 
+unsigned short img_ship_trim_height = 24; 
+short img_ship_pivot_x = 8; 
+short img_ship_pivot_y = 12; 
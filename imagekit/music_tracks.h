@@ -0,0 +1,10 @@
+// XA music tracks, generated by imagekit/tools/xaenc. Do not edit.
+#define MUSIC_TRACK_COUNT 1
+#define MUSIC_INTERLEAVE 16 // sectors, one of each channel
+#define MUSIC_FILE_NUMBER 1
+#define MUSIC_DOUBLE_SPEED 1
+#define MUSIC_LENGTH 1428 // sectors of every channel
+#define TRACK_MUSIC 0 // 152.3 s
+short musicTrackLength[MUSIC_TRACK_COUNT ? MUSIC_TRACK_COUNT : 1] = {
+	1428 // music
+};
@@ -0,0 +1,971 @@
+/*
+ * assetc.c
+ *
+ * Native asset compiler, the Linux replacement for convert-images.bat.
+ * Reads every BMP and PNG of an image folder, quantizes them to 4 or 8-bit,
+ * packs them into VRAM with vrampack.h and writes the TIM files, images.h and
+ * vram_layout.h in one run.
+ *
+ *   assetc [-j jobs] [-bpp 4|8|auto] [-e error] [-n] [-o images.h]
+ *          [-l vram_layout.h] [-t timdir] [-c cachedir] [-a] imagedir
+ *
+ * -bpp auto (the default) makes an image 4-bit unless its 16-colour version
+ * is off by more than -e (RMS, in 8-bit RGB steps, 6 by default) from the
+ * source; half the VRAM of 8-bit and a quarter of the texture cache misses.
+ * Images of the same depth whose colours fit in one palette together share
+ * a single CLUT, their indexes remapped, so sprites drawn from the same
+ * colours cost one CLUT in VRAM.
+ *
+ * The transparent borders of every image are cropped (not with -n), so the
+ * GPU never fills texels that show nothing. Each TIM ends with a sprite
+ * block past its pixel data, which GsGetTimInfo() does not look at:
+ *
+ *   "SPRT", short sourceW, sourceH, trimX, trimY, w, h, pivotX, pivotY
+ *
+ * trimX/trimY place the w x h cropped image in the source image, the pivot
+ * (the centre of the source image) is relative to the cropped one. The
+ * runtime sizes and places sprites by it; images.h has the same numbers.
+ *
+ * With -a the TIM data stays out of images.h, which then only has the
+ * placement and size of every image: the TIMs in timdir go into the CD
+ * archive (see assetpak.c) and are loaded at runtime.
+ *
+ * Decoding and quantizing run on -j threads (all cores by default). The
+ * quantized TIM of every image is kept in the cache folder (imagedir/.cache)
+ * under a hash of the source file and options, so only changed images are
+ * converted again; placement and the headers are redone every run, which is
+ * cheap. Like img2tim -tcol 0 0 0 -usealpha, black and transparent pixels
+ * become the transparent colour 0.
+ *
+ * Build: cc -O2 -o assetc assetc.c -lz -lpthread -lm
+ */
+
+#include <dirent.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "vrampack.h"
+
+#define MAX_ASSETS 256
+#define SPRITE_BLOCK_SIZE 20
+#define ASSETC_VERSION 3 // bump when the TIM output changes, invalidates the cache
+
+typedef struct {
+	char name[58];          // img_<file name without extension>
+	char path[512];
+	int bpp;                // 0 for auto until converted
+	int clut;               // in cluts[], after sharing
+	int colors;             // distinct colours used
+	int w, h;               // in texels, after padding
+	int sourceW, sourceH;   // as in the source image
+	int trimX, trimY;       // of the cropped image in the source one
+	int trimW, trimH;       // cropped size, before padding
+	int pivotX, pivotY;     // relative to the cropped image
+	unsigned char *tim;     // TIM file, position fields filled in after packing
+	int timSize;
+	unsigned long long hash;
+	int cached;
+	char error[128];
+} Asset;
+
+Asset assets[MAX_ASSETS];
+int assetCount;
+int nextAsset;
+pthread_mutex_t assetLock = PTHREAD_MUTEX_INITIALIZER;
+char *cacheDir;
+int defaultBpp = 0;
+int trim = 1;          // crop transparent borders, cleared by -n
+double maxError = 6.0; // for -bpp auto
+int headerData = 1; // images.h carries the TIM arrays, cleared by -a
+
+/* ---- files ---- */
+
+unsigned char *readFile(const char *path, int *size) {
+	FILE *f = fopen(path, "rb");
+	unsigned char *data;
+	long n;
+	if (!f) return NULL;
+	fseek(f, 0, SEEK_END);
+	n = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	data = malloc(n + 1);
+	if (data && fread(data, 1, n, f) != (size_t)n) {
+		free(data);
+		data = NULL;
+	}
+	fclose(f);
+	*size = (int)n;
+	return data;
+}
+
+int writeFile(const char *path, const void *data, int size) {
+	FILE *f = fopen(path, "wb");
+	int ok;
+	if (!f) return 0;
+	ok = fwrite(data, 1, size, f) == (size_t)size;
+	return fclose(f) == 0 && ok;
+}
+
+unsigned long long fnv1a(unsigned long long h, const unsigned char *data, int size) {
+	int i;
+	for (i = 0; i < size; i++) {
+		h ^= data[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+unsigned int rd16(const unsigned char *p) { return p[0] | p[1] << 8; }
+unsigned int rd32(const unsigned char *p) { return p[0] | p[1] << 8 | p[2] << 16 | (unsigned int)p[3] << 24; }
+unsigned int be32(const unsigned char *p) { return (unsigned int)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3]; }
+void wr16(unsigned char *p, int v) { p[0] = v; p[1] = v >> 8; }
+void wr32(unsigned char *p, unsigned int v) { p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24; }
+
+/* ---- decoders, both return w*h RGBA ---- */
+
+int maskShift(unsigned int mask) {
+	int s = 0;
+	if (!mask) return 0;
+	while (!(mask & 1)) { mask >>= 1; s++; }
+	return s;
+}
+
+int maskScale(unsigned int mask) {
+	if (!mask) return 0;
+	while (!(mask & 1)) mask >>= 1;
+	return mask;
+}
+
+unsigned char *loadBmp(const unsigned char *d, int size, int *w, int *h, char *error) {
+	int offset, bpp, compression, width, height, flip, stride, x, y, i, colors, hasAlpha = 0;
+	unsigned int masks[4] = { 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000 };
+	const unsigned char *palette, *row;
+	unsigned char *out, *p;
+	unsigned int v;
+
+	if (size < 54 || d[0] != 'B' || d[1] != 'M') { strcpy(error, "not a BMP"); return NULL; }
+	offset = rd32(d + 10);
+	width = (int)rd32(d + 18);
+	height = (int)rd32(d + 22);
+	bpp = rd16(d + 28);
+	compression = rd32(d + 30);
+	colors = rd32(d + 46);
+	if (compression != 0 && compression != 3) { strcpy(error, "compressed BMPs are not supported"); return NULL; }
+	if (bpp != 1 && bpp != 4 && bpp != 8 && bpp != 24 && bpp != 32) { strcpy(error, "unsupported BMP depth"); return NULL; }
+	if (compression == 3) {
+		masks[0] = rd32(d + 54);
+		masks[1] = rd32(d + 58);
+		masks[2] = rd32(d + 62);
+		masks[3] = rd32(d + 14) >= 56 ? rd32(d + 66) : 0;
+	}
+	flip = height > 0;
+	if (height < 0) height = -height;
+	stride = (width * bpp + 31) / 32 * 4;
+	if (offset + stride * height > size) { strcpy(error, "truncated BMP"); return NULL; }
+	palette = d + 14 + rd32(d + 14);
+	if (!colors) colors = 1 << (bpp < 16 ? bpp : 0);
+
+	out = malloc(width * height * 4);
+	for (y = 0; y < height; y++) {
+		row = d + offset + (flip ? height - 1 - y : y) * stride;
+		for (x = 0; x < width; x++) {
+			p = out + (y * width + x) * 4;
+			if (bpp <= 8) {
+				i = (row[x * bpp / 8] >> (8 - bpp - (x * bpp % 8))) & ((1 << bpp) - 1);
+				if (i >= colors) i = 0;
+				p[0] = palette[i * 4 + 2];
+				p[1] = palette[i * 4 + 1];
+				p[2] = palette[i * 4];
+				p[3] = 255;
+			} else if (bpp == 24) {
+				p[0] = row[x * 3 + 2];
+				p[1] = row[x * 3 + 1];
+				p[2] = row[x * 3];
+				p[3] = 255;
+			} else {
+				v = rd32(row + x * 4);
+				p[0] = ((v & masks[0]) >> maskShift(masks[0])) * 255 / maskScale(masks[0]);
+				p[1] = ((v & masks[1]) >> maskShift(masks[1])) * 255 / maskScale(masks[1]);
+				p[2] = ((v & masks[2]) >> maskShift(masks[2])) * 255 / maskScale(masks[2]);
+				p[3] = masks[3] ? ((v & masks[3]) >> maskShift(masks[3])) * 255 / maskScale(masks[3]) : 255;
+				if (p[3]) hasAlpha = 1;
+			}
+		}
+	}
+	// 32-bit BMPs often leave the alpha byte at 0, that means opaque
+	if (bpp == 32 && !hasAlpha) {
+		for (i = 0; i < width * height; i++) out[i * 4 + 3] = 255;
+	}
+	*w = width;
+	*h = height;
+	return out;
+}
+
+int paeth(int a, int b, int c) {
+	int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+	if (pa <= pb && pa <= pc) return a;
+	return pb <= pc ? b : c;
+}
+
+unsigned char *loadPng(const unsigned char *d, int size, int *w, int *h, char *error) {
+	static const int channelsOf[7] = { 1, 0, 3, 1, 2, 0, 4 };
+	int pos = 8, width = 0, height = 0, depth = 0, type = 0, interlace = 0, channels, bpp, stride;
+	int x, y, i, v, idatSize = 0, paletteSize = 0, trnsSize = 0;
+	unsigned char palette[768], trns[256], *idat = NULL, *raw, *out, *p, *line, *prev;
+	unsigned int len;
+	uLongf rawSize;
+
+	if (size < 8 || memcmp(d, "\x89PNG\r\n\x1a\n", 8)) { strcpy(error, "not a PNG"); return NULL; }
+	while (pos + 12 <= size) {
+		len = be32(d + pos);
+		if (pos + 12 + len > (unsigned int)size) break;
+		if (!memcmp(d + pos + 4, "IHDR", 4)) {
+			width = be32(d + pos + 8);
+			height = be32(d + pos + 12);
+			depth = d[pos + 16];
+			type = d[pos + 17];
+			interlace = d[pos + 20];
+		} else if (!memcmp(d + pos + 4, "PLTE", 4)) {
+			paletteSize = len / 3 > 256 ? 256 : len / 3;
+			memcpy(palette, d + pos + 8, paletteSize * 3);
+		} else if (!memcmp(d + pos + 4, "tRNS", 4)) {
+			trnsSize = len > 256 ? 256 : len;
+			memcpy(trns, d + pos + 8, trnsSize);
+		} else if (!memcmp(d + pos + 4, "IDAT", 4)) {
+			idat = realloc(idat, idatSize + len);
+			memcpy(idat + idatSize, d + pos + 8, len);
+			idatSize += len;
+		} else if (!memcmp(d + pos + 4, "IEND", 4)) {
+			break;
+		}
+		pos += 12 + len;
+	}
+	if (!width || !idat || type > 6 || !channelsOf[type]) { free(idat); strcpy(error, "broken PNG"); return NULL; }
+	if (interlace) { free(idat); strcpy(error, "interlaced PNGs are not supported"); return NULL; }
+
+	channels = channelsOf[type];
+	bpp = (channels * depth + 7) / 8;      // bytes per pixel for the filters
+	stride = (width * channels * depth + 7) / 8;
+	rawSize = (uLongf)(stride + 1) * height;
+	raw = malloc(rawSize);
+	if (uncompress(raw, &rawSize, idat, idatSize) != Z_OK || rawSize != (uLongf)(stride + 1) * height) {
+		free(idat);
+		free(raw);
+		strcpy(error, "corrupt PNG data");
+		return NULL;
+	}
+	free(idat);
+
+	for (y = 0; y < height; y++) {
+		line = raw + y * (stride + 1) + 1;
+		prev = y ? line - stride - 1 : NULL;
+		for (x = 0; x < stride; x++) {
+			int a = x >= bpp ? line[x - bpp] : 0, b = prev ? prev[x] : 0, c = prev && x >= bpp ? prev[x - bpp] : 0;
+			switch (line[-1]) {
+				case 1: line[x] += a; break;
+				case 2: line[x] += b; break;
+				case 3: line[x] += (a + b) / 2; break;
+				case 4: line[x] += paeth(a, b, c); break;
+			}
+		}
+	}
+
+	out = malloc(width * height * 4);
+	for (y = 0; y < height; y++) {
+		line = raw + y * (stride + 1) + 1;
+		for (x = 0; x < width; x++) {
+			p = out + (y * width + x) * 4;
+			for (i = 0; i < channels; i++) {
+				if (depth == 16) v = line[(x * channels + i) * 2];
+				else if (depth == 8) v = line[x * channels + i];
+				else {
+					v = (line[x * depth / 8] >> (8 - depth - (x * depth % 8))) & ((1 << depth) - 1);
+					if (type != 3) v = v * 255 / ((1 << depth) - 1);
+				}
+				p[i] = v;
+			}
+			switch (type) {
+				case 0: p[1] = p[2] = p[0]; p[3] = 255; break;
+				case 2: p[3] = 255; break;
+				case 3:
+					v = p[0];
+					p[0] = v < paletteSize ? palette[v * 3] : 0;
+					p[1] = v < paletteSize ? palette[v * 3 + 1] : 0;
+					p[2] = v < paletteSize ? palette[v * 3 + 2] : 0;
+					p[3] = v < trnsSize ? trns[v] : 255;
+					break;
+				case 4: p[3] = p[1]; p[1] = p[2] = p[0]; break;
+			}
+		}
+	}
+	free(raw);
+	*w = width;
+	*h = height;
+	return out;
+}
+
+/* ---- quantizer ---- */
+
+typedef struct {
+	int first, count; // range of the colour list
+	int lo[3], hi[3];
+	long weight;
+} Box;
+
+typedef struct {
+	unsigned short color; // 15-bit BGR555
+	unsigned short key;   // channel the box is being split on
+	int count;
+} ColorCount;
+
+int channelOf(unsigned short c, int ch) {
+	return (c >> (ch * 5)) & 31;
+}
+
+int compareChannel(const void *a, const void *b) {
+	return ((const ColorCount *)a)->key - ((const ColorCount *)b)->key;
+}
+
+void boxShrink(Box *box, ColorCount *colors) {
+	int i, ch, v;
+	box->weight = 0;
+	for (ch = 0; ch < 3; ch++) {
+		box->lo[ch] = 31;
+		box->hi[ch] = 0;
+	}
+	for (i = box->first; i < box->first + box->count; i++) {
+		box->weight += colors[i].count;
+		for (ch = 0; ch < 3; ch++) {
+			v = channelOf(colors[i].color, ch);
+			if (v < box->lo[ch]) box->lo[ch] = v;
+			if (v > box->hi[ch]) box->hi[ch] = v;
+		}
+	}
+}
+
+// Median cut over the 15-bit colours actually used. Palette entry 0 is kept
+// for the transparent colour, so at most (1 << bpp) - 1 boxes are made.
+// Returns the palette size, lut maps every used 15-bit colour to an index;
+// *error gets the summed squared error over the opaque pixels (5-bit steps).
+int quantize(unsigned short *pixels, int n, int bpp, unsigned short *palette, unsigned char *lut, double *error) {
+	int *histogram = calloc(32768, sizeof(int));
+	ColorCount *colors;
+	Box boxes[256];
+	int i, j, ch, boxCount = 1, unique = 0, maxBoxes = (1 << bpp) - 1;
+	int best, bestRange, range, half, sum, split;
+	long r, g, b, weight, d, bestDist;
+
+	for (i = 0; i < n; i++) {
+		if (pixels[i] != 0xffff) histogram[pixels[i]]++;
+	}
+	for (i = 0; i < 32768; i++) unique += histogram[i] > 0;
+	colors = malloc((unique ? unique : 1) * sizeof(ColorCount));
+	for (i = 0, j = 0; i < 32768; i++) {
+		if (!histogram[i]) continue;
+		colors[j].color = i;
+		colors[j].count = histogram[i];
+		j++;
+	}
+
+	palette[0] = 0; // transparent
+	*error = 0;
+	if (!unique) {
+		free(histogram);
+		free(colors);
+		return 1;
+	}
+	boxes[0].first = 0;
+	boxes[0].count = unique;
+	boxShrink(&boxes[0], colors);
+
+	while (boxCount < maxBoxes) {
+		// split the box with the widest channel, weighted by its pixel count
+		best = -1;
+		bestRange = 0;
+		for (i = 0; i < boxCount; i++) {
+			if (boxes[i].count < 2) continue;
+			for (ch = 0; ch < 3; ch++) {
+				range = (boxes[i].hi[ch] - boxes[i].lo[ch]) * (int)(boxes[i].weight > 65535 ? 65535 : boxes[i].weight);
+				if (range > bestRange) {
+					bestRange = range;
+					best = i * 3 + ch;
+				}
+			}
+		}
+		if (best < 0) break;
+		i = best / 3;
+		for (j = boxes[i].first; j < boxes[i].first + boxes[i].count; j++) {
+			colors[j].key = channelOf(colors[j].color, best % 3);
+		}
+		qsort(colors + boxes[i].first, boxes[i].count, sizeof(ColorCount), compareChannel);
+		half = boxes[i].weight / 2;
+		split = boxes[i].first;
+		sum = colors[split].count;
+		while (split < boxes[i].first + boxes[i].count - 2 && sum < half) {
+			sum += colors[++split].count;
+		}
+		split++;
+		boxes[boxCount].first = split;
+		boxes[boxCount].count = boxes[i].first + boxes[i].count - split;
+		boxes[i].count = split - boxes[i].first;
+		boxShrink(&boxes[i], colors);
+		boxShrink(&boxes[boxCount], colors);
+		boxCount++;
+	}
+
+	for (i = 0; i < boxCount; i++) {
+		r = g = b = weight = 0;
+		for (j = boxes[i].first; j < boxes[i].first + boxes[i].count; j++) {
+			r += channelOf(colors[j].color, 0) * (long)colors[j].count;
+			g += channelOf(colors[j].color, 1) * (long)colors[j].count;
+			b += channelOf(colors[j].color, 2) * (long)colors[j].count;
+			weight += colors[j].count;
+		}
+		palette[i + 1] = (r + weight / 2) / weight | ((g + weight / 2) / weight) << 5 | ((b + weight / 2) / weight) << 10;
+	}
+
+	for (i = 0; i < unique; i++) {
+		bestDist = 0x7fffffff;
+		for (j = 1; j <= boxCount; j++) {
+			d = 0;
+			for (ch = 0; ch < 3; ch++) {
+				range = channelOf(colors[i].color, ch) - channelOf(palette[j], ch);
+				d += range * range;
+			}
+			if (d < bestDist) {
+				bestDist = d;
+				lut[colors[i].color] = j;
+			}
+		}
+		*error += (double)bestDist * colors[i].count;
+	}
+	// black would read as transparent on the GPU, the STP bit keeps it opaque
+	for (i = 1; i <= boxCount; i++) {
+		if (!palette[i]) palette[i] = 0x8000;
+	}
+	free(histogram);
+	free(colors);
+	return boxCount + 1;
+}
+
+/* ---- TIM ---- */
+
+// Like img2tim -tcol 0 0 0 -usealpha
+int isTransparent(const unsigned char *rgba) {
+	return rgba[3] < 128 || (!rgba[0] && !rgba[1] && !rgba[2]);
+}
+
+// Crops rgba to the bounding box of its opaque pixels (1x1 when there are
+// none) in place, *x and *y get where that box starts
+void trimImage(unsigned char *rgba, int *w, int *h, int *x, int *y) {
+	int left = *w, top = *h, right = 0, bottom = 0, i, j;
+	for (j = 0; j < *h; j++) {
+		for (i = 0; i < *w; i++) {
+			if (isTransparent(rgba + (j * *w + i) * 4)) continue;
+			if (i < left) left = i;
+			if (i >= right) right = i + 1;
+			if (j < top) top = j;
+			bottom = j + 1;
+		}
+	}
+	if (right <= left) {
+		left = top = 0;
+		right = bottom = 1;
+	}
+	for (j = top; j < bottom; j++) {
+		memmove(rgba + (j - top) * (right - left) * 4, rgba + (j * *w + left) * 4, (right - left) * 4);
+	}
+	*x = left;
+	*y = top;
+	*w = right - left;
+	*h = bottom - top;
+}
+
+// Builds a 4 or 8-bit TIM at 0,0; the positions are patched in after packing.
+// *error gets the RMS error of the opaque pixels in 8-bit steps.
+unsigned char *buildTim(unsigned char *rgba, int w, int h, int bpp, int *outW, int *timSize, double *error) {
+	int paddedW = bpp == 4 ? (w + 3) & ~3 : (w + 1) & ~1;
+	int pw = paddedW * bpp / 16, n = paddedW * h, clutW = 1 << bpp;
+	int i, x, y, clutBytes = clutW * 2, pixelBytes = pw * h * 2, size, opaque = 0;
+	unsigned short *pixels = malloc(n * sizeof(unsigned short)), palette[256];
+	unsigned char *lut = calloc(32768, 1), *tim, *clut, *data, *src, index;
+
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < paddedW; x++) {
+			src = rgba + (y * w + x) * 4;
+			if (x >= w || isTransparent(src)) pixels[y * paddedW + x] = 0xffff;
+			else pixels[y * paddedW + x] = (src[0] >> 3) | (src[1] >> 3) << 5 | (src[2] >> 3) << 10;
+			opaque += pixels[y * paddedW + x] != 0xffff;
+		}
+	}
+	memset(palette, 0, sizeof(palette));
+	quantize(pixels, n, bpp, palette, lut, error);
+	*error = opaque ? sqrt(*error / (opaque * 3.0)) * 8 : 0;
+
+	size = 8 + 12 + clutBytes + 12 + pixelBytes;
+	tim = calloc(size, 1);
+	wr32(tim, 0x10);
+	wr32(tim + 4, (bpp == 4 ? 0 : 1) | 8);
+	clut = tim + 8;
+	wr32(clut, 12 + clutBytes);
+	wr16(clut + 8, clutW);
+	wr16(clut + 10, 1);
+	for (i = 0; i < clutW; i++) wr16(clut + 12 + i * 2, palette[i]);
+	data = clut + 12 + clutBytes;
+	wr32(data, 12 + pixelBytes);
+	wr16(data + 8, pw);
+	wr16(data + 10, h);
+	data += 12;
+	for (i = 0; i < n; i++) {
+		index = pixels[i] == 0xffff ? 0 : lut[pixels[i]];
+		if (bpp == 8) data[i] = index;
+		else data[i / 2] |= (i & 1) ? index << 4 : index;
+	}
+	free(pixels);
+	free(lut);
+	*outW = paddedW;
+	*timSize = size;
+	return tim;
+}
+
+unsigned char *timClut(unsigned char *tim) { return tim + 8; }
+unsigned char *timPixels(unsigned char *tim) { return tim + 8 + rd32(tim + 8); }
+int timBpp(unsigned char *tim) { return rd32(tim + 4) & 3 ? 8 : 4; }
+
+// Appends the sprite block to a->tim
+void addSpriteBlock(Asset *a) {
+	unsigned char *p;
+	a->tim = realloc(a->tim, a->timSize + SPRITE_BLOCK_SIZE);
+	p = a->tim + a->timSize;
+	memcpy(p, "SPRT", 4);
+	wr16(p + 4, a->sourceW);
+	wr16(p + 6, a->sourceH);
+	wr16(p + 8, a->trimX);
+	wr16(p + 10, a->trimY);
+	wr16(p + 12, a->trimW);
+	wr16(p + 14, a->trimH);
+	wr16(p + 16, a->pivotX);
+	wr16(p + 18, a->pivotY);
+	a->timSize += SPRITE_BLOCK_SIZE;
+}
+
+int readSpriteBlock(Asset *a) {
+	unsigned char *p = a->tim + a->timSize - SPRITE_BLOCK_SIZE;
+	if (a->timSize < SPRITE_BLOCK_SIZE || memcmp(p, "SPRT", 4)) return 0;
+	a->sourceW = rd16(p + 4);
+	a->sourceH = rd16(p + 6);
+	a->trimX = rd16(p + 8);
+	a->trimY = rd16(p + 10);
+	a->trimW = rd16(p + 12);
+	a->trimH = rd16(p + 14);
+	a->pivotX = (short)rd16(p + 16);
+	a->pivotY = (short)rd16(p + 18);
+	return 1;
+}
+
+/* ---- jobs ---- */
+
+void cachePath(char *out, int size, Asset *a, const char *ext) {
+	snprintf(out, size, "%s/%s.%s", cacheDir, a->name, ext);
+}
+
+// Decodes and quantizes one image, or takes its TIM from the cache
+void convertAsset(Asset *a) {
+	int size, cachedSize, w, h, version = ASSETC_VERSION;
+	double error;
+	unsigned char *file = readFile(a->path, &size), *rgba, *cached;
+	char path[600], key[32];
+	const char *ext = strrchr(a->path, '.');
+
+	if (!file) {
+		strcpy(a->error, "cannot read the file");
+		return;
+	}
+	a->hash = fnv1a(0xcbf29ce484222325ULL, file, size);
+	a->hash = fnv1a(a->hash, (unsigned char *)&a->bpp, sizeof(a->bpp));
+	a->hash = fnv1a(a->hash, (unsigned char *)&version, sizeof(version));
+	if (!a->bpp) a->hash = fnv1a(a->hash, (unsigned char *)&maxError, sizeof(maxError));
+	a->hash = fnv1a(a->hash, (unsigned char *)&trim, sizeof(trim));
+	snprintf(key, sizeof(key), "%016llx", a->hash);
+
+	cachePath(path, sizeof(path), a, "key");
+	cached = readFile(path, &cachedSize);
+	if (cached && cachedSize == 16 && !memcmp(cached, key, 16)) {
+		free(cached);
+		cachePath(path, sizeof(path), a, "tim");
+		a->tim = readFile(path, &a->timSize);
+		if (a->tim && readSpriteBlock(a)) {
+			a->cached = 1;
+			a->bpp = timBpp(a->tim);
+			a->w = rd16(timPixels(a->tim) + 8) * 16 / a->bpp;
+			a->h = rd16(timPixels(a->tim) + 10);
+			free(file);
+			return;
+		}
+		free(a->tim);
+		a->tim = NULL;
+	}
+	free(cached);
+
+	if (ext && !strcasecmp(ext, ".png")) rgba = loadPng(file, size, &w, &h, a->error);
+	else rgba = loadBmp(file, size, &w, &h, a->error);
+	free(file);
+	if (!rgba) return;
+
+	a->sourceW = w;
+	a->sourceH = h;
+	if (trim) trimImage(rgba, &w, &h, &a->trimX, &a->trimY);
+	a->trimW = w;
+	a->trimH = h;
+	a->pivotX = a->sourceW / 2 - a->trimX;
+	a->pivotY = a->sourceH / 2 - a->trimY;
+	a->h = h;
+	if (a->bpp) {
+		a->tim = buildTim(rgba, w, h, a->bpp, &a->w, &a->timSize, &error);
+	} else {
+		a->bpp = 4;
+		a->tim = buildTim(rgba, w, h, 4, &a->w, &a->timSize, &error);
+		if (error > maxError) {
+			free(a->tim);
+			a->bpp = 8;
+			a->tim = buildTim(rgba, w, h, 8, &a->w, &a->timSize, &error);
+		}
+	}
+	free(rgba);
+	addSpriteBlock(a);
+
+	cachePath(path, sizeof(path), a, "tim");
+	writeFile(path, a->tim, a->timSize);
+	cachePath(path, sizeof(path), a, "key");
+	writeFile(path, key, 16);
+}
+
+void *worker(void *unused) {
+	int i;
+	(void)unused;
+	for (;;) {
+		pthread_mutex_lock(&assetLock);
+		i = nextAsset++;
+		pthread_mutex_unlock(&assetLock);
+		if (i >= assetCount) return NULL;
+		convertAsset(&assets[i]);
+	}
+}
+
+int compareAssets(const void *a, const void *b) {
+	return strcmp(((const Asset *)a)->name, ((const Asset *)b)->name);
+}
+
+/* ---- CLUT sharing ---- */
+
+typedef struct {
+	int bpp;
+	int count;                 // entries used, 0 is the transparent colour
+	unsigned short colors[256];
+} SharedClut;
+
+SharedClut cluts[MAX_ASSETS];
+int clutCount;
+
+int timIndex(Asset *a, int i) {
+	unsigned char *data = timPixels(a->tim) + 12;
+	if (a->bpp == 8) return data[i];
+	return i & 1 ? data[i / 2] >> 4 : data[i / 2] & 15;
+}
+
+void timSetIndex(Asset *a, int i, int index) {
+	unsigned char *data = timPixels(a->tim) + 12;
+	if (a->bpp == 8) data[i] = index;
+	else data[i / 2] = i & 1 ? (data[i / 2] & 15) | index << 4 : (data[i / 2] & 0xf0) | index;
+}
+
+// Distinct colours of the palette entries the image uses, transparent left out
+int usedColors(Asset *a, unsigned short *colors) {
+	unsigned char *clut = timClut(a->tim) + 12;
+	int used[256], i, j, n = 0, pixels = a->w * a->h;
+	memset(used, 0, sizeof(used));
+	for (i = 0; i < pixels; i++) used[timIndex(a, i)] = 1;
+	for (i = 1; i < (1 << a->bpp); i++) {
+		if (!used[i]) continue;
+		for (j = 0; j < n && colors[j] != rd16(clut + i * 2); j++);
+		if (j == n) colors[n++] = rd16(clut + i * 2);
+	}
+	return n;
+}
+
+int clutFind(SharedClut *c, unsigned short color) {
+	int i;
+	for (i = 1; i < c->count; i++) {
+		if (c->colors[i] == color) return i;
+	}
+	return -1;
+}
+
+int compareColors(const void *a, const void *b) {
+	return (*(Asset **)b)->colors - (*(Asset **)a)->colors;
+}
+
+// Gives every image a CLUT, shared with the images of the same depth already
+// placed when its colours fit in with theirs; the one that needs the fewest
+// new entries wins. The images with the most colours go first. Pixel indexes
+// are remapped to the shared palette.
+void shareCluts() {
+	Asset *order[MAX_ASSETS], *a;
+	SharedClut *c;
+	unsigned short colors[256];
+	unsigned char *clut;
+	int remap[256], i, j, k, n, missing, best, bestMissing, pixels;
+
+	for (i = 0; i < assetCount; i++) {
+		order[i] = &assets[i];
+		assets[i].colors = usedColors(&assets[i], colors);
+	}
+	qsort(order, assetCount, sizeof(Asset *), compareColors);
+	clutCount = 0;
+	for (i = 0; i < assetCount; i++) {
+		a = order[i];
+		n = usedColors(a, colors);
+		best = -1;
+		bestMissing = 0;
+		for (j = 0; j < clutCount; j++) {
+			if (cluts[j].bpp != a->bpp) continue;
+			for (k = 0, missing = 0; k < n; k++) missing += clutFind(&cluts[j], colors[k]) < 0;
+			if (cluts[j].count + missing > (1 << a->bpp)) continue;
+			if (best < 0 || missing < bestMissing) {
+				best = j;
+				bestMissing = missing;
+			}
+		}
+		if (best < 0) {
+			best = clutCount++;
+			cluts[best].bpp = a->bpp;
+			cluts[best].count = 1;
+			memset(cluts[best].colors, 0, sizeof(cluts[best].colors));
+		}
+		c = &cluts[best];
+		a->clut = best;
+
+		clut = timClut(a->tim) + 12;
+		for (j = 1; j < 256; j++) remap[j] = -1;
+		remap[0] = 0;
+		pixels = a->w * a->h;
+		for (j = 0; j < pixels; j++) {
+			k = timIndex(a, j);
+			if (remap[k] < 0) {
+				remap[k] = clutFind(c, rd16(clut + k * 2));
+				if (remap[k] < 0) {
+					remap[k] = c->count;
+					c->colors[c->count++] = rd16(clut + k * 2);
+				}
+			}
+			timSetIndex(a, j, remap[k]);
+		}
+	}
+	// the palettes only grow while images join, so fill them in at the end
+	for (i = 0; i < assetCount; i++) {
+		clut = timClut(assets[i].tim) + 12;
+		for (j = 0; j < (1 << assets[i].bpp); j++) wr16(clut + j * 2, cluts[assets[i].clut].colors[j]);
+	}
+}
+
+/* ---- output ---- */
+
+// Writes the file only when its content changed, so make does not rebuild
+// main.c for nothing
+int writeIfChanged(const char *path, const char *data, int size) {
+	int oldSize, same;
+	unsigned char *old = readFile(path, &oldSize);
+	same = old && oldSize == size && !memcmp(old, data, size);
+	free(old);
+	return same ? 1 : writeFile(path, data, size);
+}
+
+typedef struct {
+	char *data;
+	int size, capacity;
+} Text;
+
+void textf(Text *t, const char *format, ...) {
+	va_list args;
+	int n;
+	for (;;) {
+		va_start(args, format);
+		n = vsnprintf(t->data + t->size, t->capacity - t->size, format, args);
+		va_end(args);
+		if (t->size + n < t->capacity) break;
+		t->capacity = (t->capacity + n) * 2;
+		t->data = realloc(t->data, t->capacity);
+	}
+	t->size += n;
+}
+
+// Same layout as the header convert-images.bat made with bin2h
+void writeImagesHeader(const char *path) {
+	Text t = { NULL, 0, 0 };
+	int i, j;
+	Asset *a;
+	unsigned char *pixels, *clut;
+
+	t.capacity = 1 << 16;
+	t.data = malloc(t.capacity);
+	for (i = 0; i < assetCount; i++) {
+		a = &assets[i];
+		pixels = timPixels(a->tim);
+		clut = timClut(a->tim);
+		textf(&t, "unsigned short %s_gpu_x = %d; \n", a->name, rd16(pixels + 4));
+		textf(&t, "unsigned short %s_gpu_y = %d; \n", a->name, rd16(pixels + 6));
+		textf(&t, "unsigned short %s_clut_x = %d; \n", a->name, rd16(clut + 4));
+		textf(&t, "unsigned short %s_clut_y = %d; \n", a->name, rd16(clut + 6));
+	}
+	for (i = 0; i < assetCount; i++) {
+		textf(&t, "unsigned short %s_width = %d; \n", assets[i].name, assets[i].sourceW);
+		textf(&t, "unsigned short %s_height = %d; \n", assets[i].name, assets[i].sourceH);
+		textf(&t, "unsigned short %s_trim_x = %d; \n", assets[i].name, assets[i].trimX);
+		textf(&t, "unsigned short %s_trim_y = %d; \n", assets[i].name, assets[i].trimY);
+		textf(&t, "unsigned short %s_trim_width = %d; \n", assets[i].name, assets[i].trimW);
+		textf(&t, "unsigned short %s_trim_height = %d; \n", assets[i].name, assets[i].trimH);
+		textf(&t, "short %s_pivot_x = %d; \n", assets[i].name, assets[i].pivotX);
+		textf(&t, "short %s_pivot_y = %d; \n", assets[i].name, assets[i].pivotY);
+	}
+	for (i = 0; i < assetCount && headerData; i++) {
+		a = &assets[i];
+		textf(&t, "unsigned char %s[] = {\n", a->name);
+		for (j = 0; j < a->timSize; j++) {
+			textf(&t, "0x%02x%s", a->tim[j], j + 1 == a->timSize ? "\n" : (j % 15 == 14 ? ",\n" : ","));
+		}
+		textf(&t, "};\n");
+	}
+	if (!writeIfChanged(path, t.data, t.size)) fprintf(stderr, "assetc: cannot write %s\n", path);
+	free(t.data);
+}
+
+void usage() {
+	fprintf(stderr, "usage: assetc [-j jobs] [-bpp 4|8|auto] [-e error] [-n] [-o images.h] [-l vram_layout.h] [-t timdir] [-c cachedir] [-a] imagedir\n");
+	exit(1);
+}
+
+int main(int argc, char **argv) {
+	int i, jobs = (int)sysconf(_SC_NPROCESSORS_ONLN), failed = 0, converted = 0, len, fourBit = 0;
+	char *imageDir = NULL, *header = "images.h", *layout = "vram_layout.h", *timDir = NULL, path[600];
+	char defaultCache[520];
+	DIR *dir;
+	struct dirent *entry;
+	pthread_t threads[64];
+	PackItem items[MAX_ASSETS * 2];
+	Packer *packer;
+	Asset *a;
+	const char *ext;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-j") && i + 1 < argc) jobs = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-bpp") && i + 1 < argc) defaultBpp = strcmp(argv[++i], "auto") ? atoi(argv[i]) : 0;
+		else if (!strcmp(argv[i], "-e") && i + 1 < argc) maxError = atof(argv[++i]);
+		else if (!strcmp(argv[i], "-o") && i + 1 < argc) header = argv[++i];
+		else if (!strcmp(argv[i], "-l") && i + 1 < argc) layout = argv[++i];
+		else if (!strcmp(argv[i], "-t") && i + 1 < argc) timDir = argv[++i];
+		else if (!strcmp(argv[i], "-c") && i + 1 < argc) cacheDir = argv[++i];
+		else if (!strcmp(argv[i], "-a")) headerData = 0;
+		else if (!strcmp(argv[i], "-n")) trim = 0;
+		else if (argv[i][0] != '-' && !imageDir) imageDir = argv[i];
+		else usage();
+	}
+	if (!imageDir || (defaultBpp && defaultBpp != 4 && defaultBpp != 8)) usage();
+	if (jobs < 1) jobs = 1;
+	if (jobs > 64) jobs = 64;
+	if (!cacheDir) {
+		snprintf(defaultCache, sizeof(defaultCache), "%s/.cache", imageDir);
+		cacheDir = defaultCache;
+	}
+	mkdir(cacheDir, 0777);
+	if (timDir) mkdir(timDir, 0777);
+
+	dir = opendir(imageDir);
+	if (!dir) {
+		fprintf(stderr, "assetc: cannot open %s\n", imageDir);
+		return 1;
+	}
+	while ((entry = readdir(dir))) {
+		ext = strrchr(entry->d_name, '.');
+		if (entry->d_name[0] == '.' || !ext || (strcasecmp(ext, ".bmp") && strcasecmp(ext, ".png"))) continue;
+		if (assetCount == MAX_ASSETS) {
+			fprintf(stderr, "assetc: more than %d images\n", MAX_ASSETS);
+			return 1;
+		}
+		a = &assets[assetCount++];
+		memset(a, 0, sizeof(*a));
+		len = (int)(ext - entry->d_name);
+		if (len > 52) len = 52;
+		snprintf(a->name, sizeof(a->name), "img_%.*s", len, entry->d_name);
+		snprintf(a->path, sizeof(a->path), "%s/%s", imageDir, entry->d_name);
+		a->bpp = defaultBpp;
+	}
+	closedir(dir);
+	qsort(assets, assetCount, sizeof(Asset), compareAssets);
+
+	for (i = 0; i < jobs; i++) pthread_create(&threads[i], NULL, worker, NULL);
+	for (i = 0; i < jobs; i++) pthread_join(threads[i], NULL);
+
+	for (i = 0; i < assetCount; i++) {
+		if (assets[i].error[0]) {
+			fprintf(stderr, "assetc: %s: %s\n", assets[i].path, assets[i].error);
+			failed++;
+		}
+		converted += !assets[i].cached;
+		fourBit += assets[i].bpp == 4;
+	}
+	if (failed) return 1;
+	shareCluts();
+	memset(items, 0, sizeof(items));
+
+	// a texture item per image, same order as the assets, then the CLUTs
+	for (i = 0; i < assetCount; i++) {
+		a = &assets[i];
+		strcpy(items[i].name, a->name);
+		items[i].w = packPixelWidth(a->w, a->bpp);
+		items[i].h = a->h;
+		items[i].mode = packModeFromBpp(a->bpp);
+		if (items[assetCount + a->clut].name[0]) continue;
+		snprintf(items[assetCount + a->clut].name, sizeof(items[i].name), "%.52s_clut", a->name);
+		items[assetCount + a->clut].w = 1 << a->bpp;
+		items[assetCount + a->clut].h = 1;
+		items[assetCount + a->clut].mode = PACK_CLUT;
+	}
+	packer = malloc(sizeof(Packer));
+	packInit(packer);
+	{
+		PackRect display = { 0, 0, 320, 512 }, font = { 960, 256, 64, 256 };
+		packOccupy(packer, &display);
+		packOccupy(packer, &font);
+	}
+	if (packAll(packer, items, assetCount + clutCount)) {
+		for (i = 0; i < assetCount + clutCount; i++) {
+			if (items[i].x < 0) fprintf(stderr, "assetc: no VRAM left for %s\n", items[i].name);
+		}
+		return 1;
+	}
+	free(packer);
+
+	for (i = 0; i < assetCount; i++) {
+		a = &assets[i];
+		wr16(timPixels(a->tim) + 4, items[i].x);
+		wr16(timPixels(a->tim) + 6, items[i].y);
+		wr16(timClut(a->tim) + 4, items[assetCount + a->clut].x);
+		wr16(timClut(a->tim) + 6, items[assetCount + a->clut].y);
+		if (timDir) {
+			snprintf(path, sizeof(path), "%s/%s.tim", timDir, a->name + 4);
+			writeFile(path, a->tim, a->timSize);
+		}
+	}
+	writeImagesHeader(header);
+	if (!packWriteLayout(layout, items, assetCount + clutCount)) {
+		fprintf(stderr, "assetc: cannot write %s\n", layout);
+		return 1;
+	}
+	printf("assetc: %d images (%d 4-bit, %d 8-bit, %d CLUTs), %d converted, %d from cache\n",
+		assetCount, fourBit, assetCount - fourBit, clutCount, converted, assetCount - converted);
+	return 0;
+}
@@ -0,0 +1,303 @@
+/*
+ * assetpak.c
+ *
+ * Packs asset files into the CD archive read by archive.h, and writes the
+ * header with the index of every entry.
+ *
+ *   assetpak -o ASSETS.PAK [-H assets.h] [-t trace.txt] [-z] [-b] [name=]file...
+ *
+ * Without a name the entry is called after the file name, minus its folder
+ * and extension. With an access trace (see discbuild.c) the entries' data is
+ * laid out in the order the game first reads them, so a level's assets are
+ * read without seeking; the table of contents and the indexes keep the
+ * command line order.
+ *
+ * With -z every entry is packed with each method of lz.h and stored the way
+ * that takes the fewest sectors, which is what a read costs; on a tie it is
+ * left as it is, or packed with LZ4, the faster one to decode. -b prints
+ * every method's size and host decode speed for each entry.
+ *
+ * Layout, little endian, in 2048-byte sectors:
+ *
+ *   ArchiveHeader { magic "PAK2", count, tocSectors, reserved }
+ *   ArchiveEntry  { char name[16], sector, size, packed, margin, method } * count
+ *   padding to tocSectors sectors, then every entry on its own sector
+ *
+ * size is the unpacked size and packed what is stored; margin is how far
+ * into the output buffer the packed data has to start to be decoded in place.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lzpack.h"
+
+#define PAK_SECTOR 2048
+#define PAK_NAME_MAX 16 // with the terminating 0
+#define PAK_ENTRY_SIZE 36
+#define PAK_HEADER_SIZE 16
+#define PAK_MAX 256
+#define TRACE_MAX 4096
+
+typedef struct {
+	char name[PAK_NAME_MAX];
+	const char *path;
+	unsigned char *data;
+	long size;
+	unsigned char *packed; // what goes in the archive, data when stored
+	long packedSize;
+	int margin;
+	int method;
+	long sector;
+	int order;          // first read in the trace, or after all the traced entries
+} PakEntry;
+
+PakEntry entries[PAK_MAX];
+int entryCount;
+
+void put32(unsigned char *p, unsigned long v) {
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+long sectorsOf(long bytes) {
+	return (bytes + PAK_SECTOR - 1) / PAK_SECTOR;
+}
+
+int addEntry(const char *arg) {
+	PakEntry *e = &entries[entryCount];
+	const char *equals = strchr(arg, '='), *base, *dot;
+	FILE *f;
+	int i, len;
+
+	if (entryCount == PAK_MAX) {
+		fprintf(stderr, "assetpak: more than %d entries\n", PAK_MAX);
+		return 0;
+	}
+	if (equals) {
+		base = arg;
+		len = (int)(equals - arg);
+		e->path = equals + 1;
+	} else {
+		base = strrchr(arg, '/') ? strrchr(arg, '/') + 1 : arg;
+		dot = strrchr(base, '.');
+		len = dot ? (int)(dot - base) : (int)strlen(base);
+		e->path = arg;
+	}
+	if (len <= 0 || len >= PAK_NAME_MAX) {
+		fprintf(stderr, "assetpak: %s: names are 1 to %d characters\n", arg, PAK_NAME_MAX - 1);
+		return 0;
+	}
+	memset(e->name, 0, PAK_NAME_MAX);
+	for (i = 0; i < len; i++) e->name[i] = tolower((unsigned char)base[i]);
+	for (i = 0; i < entryCount; i++) {
+		if (!strcmp(entries[i].name, e->name)) {
+			fprintf(stderr, "assetpak: %s is in the archive twice\n", e->name);
+			return 0;
+		}
+	}
+
+	f = fopen(e->path, "rb");
+	if (!f) {
+		fprintf(stderr, "assetpak: cannot read %s\n", e->path);
+		return 0;
+	}
+	fseek(f, 0, SEEK_END);
+	e->size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	e->data = malloc(e->size ? e->size : 1);
+	if (fread(e->data, 1, e->size, f) != (size_t)e->size) {
+		fclose(f);
+		fprintf(stderr, "assetpak: cannot read %s\n", e->path);
+		return 0;
+	}
+	fclose(f);
+	e->packed = e->data;
+	e->packedSize = e->size;
+	e->margin = 0;
+	e->method = LZ_NONE;
+	e->order = TRACE_MAX + entryCount;
+	entryCount++;
+	return 1;
+}
+
+// Reads the "ARCHIVE/entry" lines of an access trace
+int readTrace(const char *path) {
+	FILE *f = fopen(path, "r");
+	char line[256], *p, *end;
+	int i, position = 0;
+
+	if (!f) {
+		fprintf(stderr, "assetpak: cannot read %s\n", path);
+		return 0;
+	}
+	while (fgets(line, sizeof(line), f)) {
+		if ((p = strchr(line, '#'))) *p = 0;
+		p = strrchr(line, '/');
+		if (!p) continue;
+		for (end = ++p; *end && !isspace((unsigned char)*end); end++) *end = tolower((unsigned char)*end);
+		*end = 0;
+		for (i = 0; i < entryCount; i++) {
+			if (!strcmp(entries[i].name, p) && entries[i].order >= TRACE_MAX) entries[i].order = position++;
+		}
+	}
+	fclose(f);
+	return 1;
+}
+
+// Packs data with method into a new buffer, returns the packed size
+long packWith(int method, const unsigned char *data, long size, unsigned char **out) {
+	*out = malloc(size + size / 8 + 16);
+	if (method == LZ_LZSS) return lzssEncode(data, size, *out);
+	return lz4Encode(data, size, *out);
+}
+
+// Keeps the method that reads the fewest sectors, trying the faster decoder first
+void compressEntry(PakEntry *e) {
+	static const int methods[] = { LZ_LZ4, LZ_LZSS };
+	unsigned char *packed;
+	long size;
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		size = packWith(methods[i], e->data, e->size, &packed);
+		if (sectorsOf(size) < sectorsOf(e->packedSize)) {
+			if (e->packed != e->data) free(e->packed);
+			e->packed = packed;
+			e->packedSize = size;
+			e->method = methods[i];
+			e->margin = lzMargin(e->method, packed, e->size);
+		} else {
+			free(packed);
+		}
+	}
+}
+
+// Decode speed of the methods on the host, a rough guide for the R3000
+void benchmark(PakEntry *e) {
+	static const int methods[] = { LZ_LZSS, LZ_LZ4 };
+	static const char *names[] = { "lzss", "lz4" };
+	unsigned char *packed, *out = malloc(e->size ? e->size : 1);
+	long size;
+	clock_t start, elapsed;
+	int i, runs;
+
+	printf("%-15s %7ld bytes %4ld sectors\n", e->name, e->size, sectorsOf(e->size));
+	for (i = 0; i < 2; i++) {
+		size = packWith(methods[i], e->data, e->size, &packed);
+		start = clock();
+		runs = 0;
+		do {
+			lzDecode(methods[i], packed, out, e->size);
+			runs++;
+		} while ((elapsed = clock() - start) < CLOCKS_PER_SEC / 10);
+		if (memcmp(out, e->data, e->size)) printf("  %-5s does not decode back\n", names[i]);
+		printf("  %-5s %7ld bytes %4ld sectors %6.1f%%  margin %5d  %7.1f MB/s\n", names[i], size, sectorsOf(size),
+			e->size ? 100.0 * size / e->size : 0.0, lzMargin(methods[i], packed, e->size),
+			(double)e->size * runs / 1048576 / ((double)elapsed / CLOCKS_PER_SEC));
+		free(packed);
+	}
+	free(out);
+}
+
+int compareOrder(const void *a, const void *b) {
+	return (*(PakEntry **)a)->order - (*(PakEntry **)b)->order;
+}
+
+int writeArchive(const char *path) {
+	long tocSectors = sectorsOf(PAK_HEADER_SIZE + entryCount * PAK_ENTRY_SIZE), sector = tocSectors;
+	unsigned char *toc = calloc(tocSectors, PAK_SECTOR), pad[PAK_SECTOR], *p;
+	PakEntry *layout[PAK_MAX], *e;
+	FILE *f;
+	int i, ok;
+
+	memcpy(toc, "PAK2", 4);
+	put32(toc + 4, entryCount);
+	put32(toc + 8, tocSectors);
+	for (i = 0; i < entryCount; i++) layout[i] = &entries[i];
+	qsort(layout, entryCount, sizeof(PakEntry *), compareOrder);
+	for (i = 0; i < entryCount; i++) {
+		layout[i]->sector = sector;
+		sector += sectorsOf(layout[i]->packedSize);
+	}
+	for (i = 0; i < entryCount; i++) {
+		p = toc + PAK_HEADER_SIZE + i * PAK_ENTRY_SIZE;
+		memcpy(p, entries[i].name, PAK_NAME_MAX);
+		put32(p + 16, entries[i].sector);
+		put32(p + 20, entries[i].size);
+		put32(p + 24, entries[i].packedSize);
+		put32(p + 28, entries[i].margin);
+		put32(p + 32, entries[i].method);
+	}
+
+	f = fopen(path, "wb");
+	if (!f) return 0;
+	memset(pad, 0, sizeof(pad));
+	ok = fwrite(toc, PAK_SECTOR, tocSectors, f) == (size_t)tocSectors;
+	for (i = 0; i < entryCount && ok; i++) {
+		e = layout[i];
+		ok = fwrite(e->packed, 1, e->packedSize, f) == (size_t)e->packedSize;
+		if (e->packedSize % PAK_SECTOR) ok = ok && fwrite(pad, 1, PAK_SECTOR - e->packedSize % PAK_SECTOR, f) == (size_t)(PAK_SECTOR - e->packedSize % PAK_SECTOR);
+	}
+	free(toc);
+	return fclose(f) == 0 && ok;
+}
+
+int writeIndex(const char *path) {
+	FILE *f = fopen(path, "w");
+	int i, j;
+	if (!f) return 0;
+	fprintf(f, "// Asset archive index, generated by imagekit/tools/assetpak. Do not edit.\n");
+	fprintf(f, "#define ASSET_COUNT %d\n", entryCount);
+	for (i = 0; i < entryCount; i++) {
+		fprintf(f, "#define ASSET_");
+		for (j = 0; entries[i].name[j]; j++) fputc(isalnum((unsigned char)entries[i].name[j]) ? toupper((unsigned char)entries[i].name[j]) : '_', f);
+		fprintf(f, " %d // %ld bytes\n", i, entries[i].size);
+	}
+	return fclose(f) == 0;
+}
+
+void usage() {
+	fprintf(stderr, "usage: assetpak -o ASSETS.PAK [-H assets.h] [-t trace.txt] [-z] [-b] [name=]file...\n");
+	exit(1);
+}
+
+int main(int argc, char **argv) {
+	static const char *methodNames[] = { "stored", "lzss", "lz4" };
+	const char *output = NULL, *index = NULL, *trace = NULL;
+	int i, compress = 0, bench = 0;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-o") && i + 1 < argc) output = argv[++i];
+		else if (!strcmp(argv[i], "-H") && i + 1 < argc) index = argv[++i];
+		else if (!strcmp(argv[i], "-t") && i + 1 < argc) trace = argv[++i];
+		else if (!strcmp(argv[i], "-z")) compress = 1;
+		else if (!strcmp(argv[i], "-b")) bench = 1;
+		else if (argv[i][0] == '-') usage();
+		else if (!addEntry(argv[i])) return 1;
+	}
+	if (bench) {
+		for (i = 0; i < entryCount; i++) benchmark(&entries[i]);
+		if (!output) return 0;
+	}
+	if (!output) usage();
+	for (i = 0; i < entryCount && compress; i++) compressEntry(&entries[i]);
+	if (trace && !readTrace(trace)) return 1;
+	if (!writeArchive(output)) {
+		fprintf(stderr, "assetpak: cannot write %s\n", output);
+		return 1;
+	}
+	if (index && !writeIndex(index)) {
+		fprintf(stderr, "assetpak: cannot write %s\n", index);
+		return 1;
+	}
+	for (i = 0; i < entryCount; i++) {
+		printf("%-15s sector %5ld  %7ld bytes  %-6s %7ld  %s\n", entries[i].name, entries[i].sector, entries[i].size,
+			methodNames[entries[i].method], entries[i].packedSize, entries[i].path);
+	}
+	return 0;
+}
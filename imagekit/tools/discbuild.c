@@ -0,0 +1,534 @@
+/*
+ * discbuild.c
+ *
+ * Builds the PlayStation disc image on Linux, in place of BUILDCD, STRIPISO
+ * and PSXLICENSE: a single Mode 2 data track of raw 2352-byte sectors (sync,
+ * header, XA subheader, EDC/ECC) with an ISO 9660 file system, and its cue
+ * sheet.
+ *
+ *   discbuild -o GAME [-V volume] [-l licensee.dat] [-t trace.txt] NAME=file...
+ *
+ * writes GAME.bin and GAME.cue. The files sit in the root directory. Their
+ * order on the disc follows the access trace: every file goes where the
+ * trace first reads it, so what the game reads in a row is contiguous and
+ * the drive does not seek in between. Files the trace never mentions come
+ * last, in command line order. A trace is a text file with one name per
+ * line, in the order the game reads them; '#' starts a comment and
+ * "FILE/entry" lines (archive entries, see assetpak -t) count as a read of
+ * FILE. Debug builds print such lines as "trace ..." (archive.h).
+ *
+ * A file whose name ends in .XA is taken as raw 2336-byte Mode 2 Form 2
+ * sectors, subheader included (XA-ADPCM from xaenc), and goes on the disc
+ * sector for sector with its EDC filled in, marked as interleaved Form 2.
+ *
+ * The license file is the 12 sectors (28032 bytes) of 2336-byte Mode 2
+ * data that cdgen puts in the system area; without one the system area is
+ * left blank, which emulators accept but a real console will not boot.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SECTOR_RAW 2352
+#define SECTOR_DATA 2048
+#define SECTOR_M2 2336           // subheader + data + EDC/ECC, as in the license file
+#define SECTOR_FORM2 2324
+#define SYSTEM_AREA 16
+#define LICENSE_SECTORS 12
+#define PREGAP 150               // lead-in, in sectors, the disc LBA 0 is at 00:02:00
+#define POSTGAP 150
+#define MAX_FILES 64
+#define TRACE_MAX 1024
+
+// XA subheader submode bits
+#define SUBMODE_EOR 0x01
+#define SUBMODE_DATA 0x08
+#define SUBMODE_FORM2 0x20
+#define SUBMODE_EOF 0x80
+
+typedef struct {
+	char name[32];      // ISO name, "MAIN.EXE"
+	const char *path;
+	unsigned char *data;
+	long size;
+	long lba;
+	long sectors;
+	int form2;          // raw Form 2 sectors, see writeForm2()
+	int fileNumber;     // in their subheaders
+	int order;          // first read in the trace, or after all the traced files
+} DiscFile;
+
+DiscFile files[MAX_FILES];
+int fileCount;
+unsigned char *license;
+const char *volume = "GAME";
+struct tm now;
+
+/* ---- EDC/ECC, as in the CD-ROM XA (Yellow Book) spec ---- */
+
+unsigned char eccF[256], eccB[256];
+unsigned long edcTable[256];
+
+void eccInit() {
+	unsigned int i, j, edc;
+	for (i = 0; i < 256; i++) {
+		j = (i << 1) ^ (i & 0x80 ? 0x11d : 0);
+		eccF[i] = j;
+		eccB[i ^ j] = i;
+		edc = i;
+		for (j = 0; j < 8; j++) edc = (edc >> 1) ^ (edc & 1 ? 0xd8018001 : 0);
+		edcTable[i] = edc;
+	}
+}
+
+unsigned long edcCompute(const unsigned char *src, int size) {
+	unsigned long edc = 0;
+	while (size--) edc = (edc >> 8) ^ edcTable[(edc ^ *src++) & 0xff];
+	return edc;
+}
+
+void eccBlock(const unsigned char *src, int majorCount, int minorCount, int majorMult, int minorInc, unsigned char *dest) {
+	int size = majorCount * minorCount, major, minor, index;
+	unsigned char a, b, v;
+	for (major = 0; major < majorCount; major++) {
+		index = (major >> 1) * majorMult + (major & 1);
+		a = b = 0;
+		for (minor = 0; minor < minorCount; minor++) {
+			v = src[index];
+			index += minorInc;
+			if (index >= size) index -= size;
+			a ^= v;
+			b ^= v;
+			a = eccF[a];
+		}
+		a = eccB[eccF[a] ^ b];
+		dest[major] = a;
+		dest[major + majorCount] = a ^ b;
+	}
+}
+
+// Mode 2 computes the ECC with the header address taken as zero
+void eccGenerate(unsigned char *sector) {
+	unsigned char address[4];
+	memcpy(address, sector + 12, 4);
+	memset(sector + 12, 0, 4);
+	eccBlock(sector + 12, 86, 24, 2, 86, sector + 0x81c); // P parity
+	eccBlock(sector + 12, 52, 43, 86, 88, sector + 0x8c8); // Q parity
+	memcpy(sector + 12, address, 4);
+}
+
+/* ---- sectors ---- */
+
+int bcd(int v) {
+	return (v / 10) << 4 | v % 10;
+}
+
+void sectorHeader(unsigned char *s, long lba) {
+	long frame = lba + PREGAP;
+	memset(s, 0xff, 12);
+	s[0] = s[11] = 0;
+	s[12] = bcd(frame / 75 / 60);
+	s[13] = bcd(frame / 75 % 60);
+	s[14] = bcd(frame % 75);
+	s[15] = 2;
+}
+
+// Form 1: 2048 bytes with EDC and ECC
+void writeForm1(FILE *f, long lba, const unsigned char *data, int bytes, int submode) {
+	unsigned char s[SECTOR_RAW];
+	unsigned long edc;
+	memset(s, 0, sizeof(s));
+	sectorHeader(s, lba);
+	s[18] = s[22] = submode | SUBMODE_DATA;
+	if (bytes) memcpy(s + 24, data, bytes);
+	edc = edcCompute(s + 16, 8 + SECTOR_DATA);
+	s[0x818] = edc;
+	s[0x819] = edc >> 8;
+	s[0x81a] = edc >> 16;
+	s[0x81b] = edc >> 24;
+	eccGenerate(s);
+	fwrite(s, 1, SECTOR_RAW, f);
+}
+
+// Form 2 with an empty payload, for the post-gap
+void writeEmptyForm2(FILE *f, long lba) {
+	unsigned char s[SECTOR_RAW];
+	unsigned long edc;
+	memset(s, 0, sizeof(s));
+	sectorHeader(s, lba);
+	s[18] = s[22] = SUBMODE_FORM2;
+	edc = edcCompute(s + 16, 8 + 2324);
+	s[0x92c] = edc;
+	s[0x92d] = edc >> 8;
+	s[0x92e] = edc >> 16;
+	s[0x92f] = edc >> 24;
+	fwrite(s, 1, SECTOR_RAW, f);
+}
+
+// Form 2 sector whose subheader and 2324 bytes of data come from the file;
+// the EDC is optional there but costs nothing
+void writeForm2(FILE *f, long lba, const unsigned char *m2) {
+	unsigned char s[SECTOR_RAW];
+	unsigned long edc;
+	memset(s, 0, sizeof(s));
+	sectorHeader(s, lba);
+	memcpy(s + 16, m2, 8 + SECTOR_FORM2);
+	edc = edcCompute(s + 16, 8 + SECTOR_FORM2);
+	s[0x92c] = edc;
+	s[0x92d] = edc >> 8;
+	s[0x92e] = edc >> 16;
+	s[0x92f] = edc >> 24;
+	fwrite(s, 1, SECTOR_RAW, f);
+}
+
+// License sectors come with their subheader, EDC and ECC already in place
+void writeLicense(FILE *f, long lba, const unsigned char *m2) {
+	unsigned char s[SECTOR_RAW];
+	sectorHeader(s, lba);
+	memcpy(s + 16, m2, SECTOR_M2);
+	fwrite(s, 1, SECTOR_RAW, f);
+}
+
+/* ---- ISO 9660 ---- */
+
+void both16(unsigned char *p, int v) {
+	p[0] = p[3] = v & 0xff;
+	p[1] = p[2] = (v >> 8) & 0xff;
+}
+
+void both32(unsigned char *p, unsigned long v) {
+	p[0] = p[7] = v;
+	p[1] = p[6] = v >> 8;
+	p[2] = p[5] = v >> 16;
+	p[3] = p[4] = v >> 24;
+}
+
+void padString(unsigned char *p, const char *s, int size) {
+	int n = (int)strlen(s);
+	memset(p, ' ', size);
+	memcpy(p, s, n < size ? n : size);
+}
+
+// 17-byte volume descriptor date
+void longDate(unsigned char *p) {
+	char text[64];
+	snprintf(text, sizeof(text), "%04d%02d%02d%02d%02d%02d00", now.tm_year + 1900, now.tm_mon + 1,
+		now.tm_mday, now.tm_hour, now.tm_min, now.tm_sec);
+	memcpy(p, text, 16);
+	p[16] = 0;
+}
+
+// Directory record with the XA system use field; returns its length
+int recordLength(int nameLen) {
+	return 33 + nameLen + !(nameLen & 1) + 14;
+}
+
+int dirRecord(unsigned char *p, const char *name, int nameLen, long lba, long size, int directory, int form2, int fileNumber) {
+	int len = recordLength(nameLen) - 14;
+	memset(p, 0, len + 14);
+	p[0] = len + 14;
+	both32(p + 2, lba);
+	both32(p + 10, size);
+	p[18] = now.tm_year;
+	p[19] = now.tm_mon + 1;
+	p[20] = now.tm_mday;
+	p[21] = now.tm_hour;
+	p[22] = now.tm_min;
+	p[23] = now.tm_sec;
+	p[25] = directory ? 2 : 0;
+	both16(p + 28, 1);
+	p[32] = nameLen;
+	memcpy(p + 33, name, nameLen);
+	// XA: owner 0, attributes (Form 1, interleaved Form 2 or directory), "XA",
+	// file number (the one in the subheaders of an XA file)
+	p[len + 4] = directory ? 0x8d : form2 ? 0x35 : 0x0d;
+	p[len + 5] = 0x55;
+	p[len + 6] = 'X';
+	p[len + 7] = 'A';
+	p[len + 8] = fileNumber;
+	return len + 14;
+}
+
+int compareNames(const void *a, const void *b) {
+	return strcmp((*(DiscFile **)a)->name, (*(DiscFile **)b)->name);
+}
+
+int compareOrder(const void *a, const void *b) {
+	return ((const DiscFile *)a)->order - ((const DiscFile *)b)->order;
+}
+
+/* ---- input ---- */
+
+int addFile(const char *arg) {
+	DiscFile *f = &files[fileCount];
+	const char *equals = strchr(arg, '=');
+	FILE *in;
+	int i;
+
+	if (fileCount == MAX_FILES) {
+		fprintf(stderr, "discbuild: more than %d files\n", MAX_FILES);
+		return 0;
+	}
+	if (!equals || equals == arg || equals - arg >= 29) {
+		fprintf(stderr, "discbuild: %s: expected NAME=file, NAME up to 28 characters\n", arg);
+		return 0;
+	}
+	memset(f->name, 0, sizeof(f->name));
+	for (i = 0; i < equals - arg; i++) f->name[i] = toupper((unsigned char)arg[i]);
+	f->path = equals + 1;
+	f->order = TRACE_MAX + fileCount;
+
+	in = fopen(f->path, "rb");
+	if (!in) {
+		fprintf(stderr, "discbuild: cannot read %s\n", f->path);
+		return 0;
+	}
+	fseek(in, 0, SEEK_END);
+	f->size = ftell(in);
+	fseek(in, 0, SEEK_SET);
+	f->data = malloc(f->size ? f->size : 1);
+	if (fread(f->data, 1, f->size, in) != (size_t)f->size) {
+		fclose(in);
+		fprintf(stderr, "discbuild: cannot read %s\n", f->path);
+		return 0;
+	}
+	fclose(in);
+	i = (int)strlen(f->name);
+	f->form2 = i > 3 && !strcmp(f->name + i - 3, ".XA");
+	if (f->form2 && f->size % SECTOR_M2) {
+		fprintf(stderr, "discbuild: %s is not made of %d-byte sectors\n", f->path, SECTOR_M2);
+		return 0;
+	}
+	f->fileNumber = f->form2 && f->size ? f->data[0] : 0;
+	f->sectors = f->form2 ? f->size / SECTOR_M2 : (f->size + SECTOR_DATA - 1) / SECTOR_DATA;
+	fileCount++;
+	return 1;
+}
+
+// Orders the files by their first read in the trace
+int readTrace(const char *path) {
+	FILE *in = fopen(path, "r");
+	char line[256], *p, *end;
+	int i, position = 0;
+
+	if (!in) {
+		fprintf(stderr, "discbuild: cannot read %s\n", path);
+		return 0;
+	}
+	while (fgets(line, sizeof(line), in)) {
+		if ((p = strchr(line, '#'))) *p = 0;
+		p = line;
+		while (isspace((unsigned char)*p)) p++;
+		if (!strncmp(p, "trace ", 6)) p += 6; // lines pasted from the TTY log
+		for (end = p; *end && !isspace((unsigned char)*end) && *end != '/'; end++) *end = toupper((unsigned char)*end);
+		*end = 0;
+		if (!*p) continue;
+		for (i = 0; i < fileCount; i++) {
+			if (!strcmp(files[i].name, p) && files[i].order >= TRACE_MAX) files[i].order = position++;
+		}
+	}
+	fclose(in);
+	return 1;
+}
+
+/* ---- output ---- */
+
+int build(const char *base) {
+	char path[512];
+	FILE *f, *cue;
+	DiscFile *sorted[MAX_FILES];
+	unsigned char sector[SECTOR_DATA], *dir, pathTable[10];
+	long lba, dirLba, dirSize, total, i, j, n;
+	int len;
+
+	qsort(files, fileCount, sizeof(DiscFile), compareOrder);
+	for (i = 0; i < fileCount; i++) sorted[i] = &files[i];
+	qsort(sorted, fileCount, sizeof(DiscFile *), compareNames);
+
+	// root directory: ".", ".." and the files in name order
+	dir = calloc(MAX_FILES + 2, SECTOR_DATA);
+	dirLba = SYSTEM_AREA + 4; // PVD, terminator, L and M path tables
+	dirSize = 0;
+	for (i = 0; i < fileCount + 2; i++) {
+		len = recordLength(i < 2 ? 1 : (int)strlen(sorted[i - 2]->name) + 2);
+		if (dirSize % SECTOR_DATA + len > SECTOR_DATA) dirSize += SECTOR_DATA - dirSize % SECTOR_DATA;
+		dirSize += len;
+	}
+	dirSize = (dirSize + SECTOR_DATA - 1) / SECTOR_DATA * SECTOR_DATA;
+	lba = dirLba + dirSize / SECTOR_DATA;
+	for (i = 0; i < fileCount; i++) {
+		files[i].lba = lba;
+		lba += files[i].sectors ? files[i].sectors : 1;
+	}
+	total = lba;
+
+	n = 0;
+	n += dirRecord(dir + n, "\0", 1, dirLba, dirSize, 1, 0, 0);
+	n += dirRecord(dir + n, "\1", 1, dirLba, dirSize, 1, 0, 0);
+	for (i = 0; i < fileCount; i++) {
+		char name[40];
+		snprintf(name, sizeof(name), "%s;1", sorted[i]->name);
+		len = recordLength((int)strlen(name));
+		if (n % SECTOR_DATA + len > SECTOR_DATA) n += SECTOR_DATA - n % SECTOR_DATA;
+		// an XA file's size counts 2048 bytes a sector, as the file system sees it
+		n += dirRecord(dir + n, name, (int)strlen(name), sorted[i]->lba,
+			sorted[i]->form2 ? sorted[i]->sectors * SECTOR_DATA : sorted[i]->size, 0, sorted[i]->form2, sorted[i]->fileNumber);
+	}
+
+	snprintf(path, sizeof(path), "%s.bin", base);
+	f = fopen(path, "wb");
+	if (!f) return 0;
+
+	// system area
+	for (i = 0; i < SYSTEM_AREA; i++) {
+		if (license && i < LICENSE_SECTORS) writeLicense(f, i, license + i * SECTOR_M2);
+		else writeForm1(f, i, NULL, 0, 0);
+	}
+
+	// primary volume descriptor
+	memset(sector, 0, sizeof(sector));
+	sector[0] = 1;
+	memcpy(sector + 1, "CD001", 5);
+	sector[6] = 1;
+	padString(sector + 8, "PLAYSTATION", 32);
+	padString(sector + 40, volume, 32);
+	both32(sector + 80, total + POSTGAP);
+	both16(sector + 120, 1);
+	both16(sector + 124, 1);
+	both16(sector + 128, SECTOR_DATA);
+	both32(sector + 132, sizeof(pathTable));
+	sector[140] = SYSTEM_AREA + 2;               // L path table, little endian
+	sector[151] = SYSTEM_AREA + 3;               // M path table, big endian (both below 256)
+	dirRecord(sector + 156, "\0", 1, dirLba, dirSize, 1, 0, 0);
+	sector[156] = 34;                            // the root record has no XA field here
+	memset(sector + 156 + 34, 0, 14);
+	padString(sector + 190, volume, 128);
+	padString(sector + 318, "", 128);
+	padString(sector + 446, "", 128);
+	padString(sector + 574, "PLAYSTATION", 128);
+	padString(sector + 702, "", 37);
+	padString(sector + 739, "", 37);
+	padString(sector + 776, "", 37);
+	longDate(sector + 813);
+	longDate(sector + 830);
+	memcpy(sector + 847, "0000000000000000", 16);
+	memcpy(sector + 864, "0000000000000000", 16);
+	sector[881] = 1;
+	memcpy(sector + 1024 + 141, "CD-XA001", 8);  // XA signature in the application use area
+	writeForm1(f, SYSTEM_AREA, sector, SECTOR_DATA, SUBMODE_EOR);
+
+	memset(sector, 0, sizeof(sector));
+	sector[0] = 255;
+	memcpy(sector + 1, "CD001", 5);
+	sector[6] = 1;
+	writeForm1(f, SYSTEM_AREA + 1, sector, SECTOR_DATA, SUBMODE_EOR | SUBMODE_EOF);
+
+	// path tables, the root only: name length, extent, parent directory 1
+	memset(pathTable, 0, sizeof(pathTable));
+	pathTable[0] = 1;
+	pathTable[2] = dirLba;
+	pathTable[3] = dirLba >> 8;
+	pathTable[6] = 1;
+	memset(sector, 0, sizeof(sector));
+	memcpy(sector, pathTable, sizeof(pathTable));
+	writeForm1(f, SYSTEM_AREA + 2, sector, SECTOR_DATA, SUBMODE_EOR | SUBMODE_EOF);
+	memset(pathTable, 0, sizeof(pathTable));
+	pathTable[0] = 1;
+	pathTable[4] = dirLba >> 8;
+	pathTable[5] = dirLba;
+	pathTable[7] = 1;
+	memcpy(sector, pathTable, sizeof(pathTable));
+	writeForm1(f, SYSTEM_AREA + 3, sector, SECTOR_DATA, SUBMODE_EOR | SUBMODE_EOF);
+
+	for (i = 0; i < dirSize / SECTOR_DATA; i++) {
+		writeForm1(f, dirLba + i, dir + i * SECTOR_DATA, SECTOR_DATA,
+			i + 1 == dirSize / SECTOR_DATA ? SUBMODE_EOR | SUBMODE_EOF : 0);
+	}
+	free(dir);
+
+	for (i = 0; i < fileCount; i++) {
+		n = files[i].sectors;
+		if (files[i].form2) {
+			for (j = 0; j < n; j++) writeForm2(f, files[i].lba + j, files[i].data + j * SECTOR_M2);
+			continue;
+		}
+		if (!n) writeForm1(f, files[i].lba, NULL, 0, SUBMODE_EOR | SUBMODE_EOF);
+		for (j = 0; j < n; j++) {
+			long bytes = files[i].size - j * SECTOR_DATA;
+			writeForm1(f, files[i].lba + j, files[i].data + j * SECTOR_DATA, bytes < SECTOR_DATA ? (int)bytes : SECTOR_DATA,
+				j + 1 == n ? SUBMODE_EOR | SUBMODE_EOF : 0);
+		}
+	}
+	for (i = 0; i < POSTGAP; i++) writeEmptyForm2(f, total + i);
+	if (fclose(f)) return 0;
+
+	snprintf(path, sizeof(path), "%s.cue", base);
+	cue = fopen(path, "w");
+	if (!cue) return 0;
+	fprintf(cue, "FILE \"%s.bin\" BINARY\n", strrchr(base, '/') ? strrchr(base, '/') + 1 : base);
+	fprintf(cue, "  TRACK 01 MODE2/2352\n");
+	fprintf(cue, "    INDEX 01 00:00:00\n");
+	if (fclose(cue)) return 0;
+
+	for (i = 0; i < fileCount; i++) {
+		printf("%-12s lba %6ld  %8ld bytes  %s\n", files[i].name, files[i].lba, files[i].size, files[i].path);
+	}
+	printf("%ld sectors, %.1f MB\n", total + POSTGAP, (total + POSTGAP) * (double)SECTOR_RAW / (1024 * 1024));
+	return 1;
+}
+
+void usage() {
+	fprintf(stderr, "usage: discbuild -o GAME [-V volume] [-l licensee.dat] [-t trace.txt] NAME=file...\n");
+	exit(1);
+}
+
+int main(int argc, char **argv) {
+	const char *output = NULL, *trace = NULL, *licensePath = NULL;
+	time_t t = time(NULL);
+	FILE *in;
+	long size;
+	int i;
+
+	now = *localtime(&t);
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-o") && i + 1 < argc) output = argv[++i];
+		else if (!strcmp(argv[i], "-V") && i + 1 < argc) volume = argv[++i];
+		else if (!strcmp(argv[i], "-l") && i + 1 < argc) licensePath = argv[++i];
+		else if (!strcmp(argv[i], "-t") && i + 1 < argc) trace = argv[++i];
+		else if (argv[i][0] == '-') usage();
+		else if (!addFile(argv[i])) return 1;
+	}
+	if (!output || !fileCount) usage();
+	if (trace && !readTrace(trace)) return 1;
+
+	if (licensePath) {
+		in = fopen(licensePath, "rb");
+		if (!in) {
+			fprintf(stderr, "discbuild: cannot read %s\n", licensePath);
+			return 1;
+		}
+		fseek(in, 0, SEEK_END);
+		size = ftell(in);
+		fseek(in, 0, SEEK_SET);
+		if (size != LICENSE_SECTORS * SECTOR_M2) {
+			fprintf(stderr, "discbuild: %s is %ld bytes, a license file is %d\n", licensePath, size, LICENSE_SECTORS * SECTOR_M2);
+			return 1;
+		}
+		license = malloc(size);
+		if (fread(license, 1, size, in) != (size_t)size) {
+			fprintf(stderr, "discbuild: cannot read %s\n", licensePath);
+			return 1;
+		}
+		fclose(in);
+	}
+
+	eccInit();
+	if (!build(output)) {
+		fprintf(stderr, "discbuild: cannot write %s.bin/.cue\n", output);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,197 @@
+/*
+ * lzpack.h
+ *
+ * Compressors for the formats lz.h decodes at runtime, used by assetpak.
+ * Both search hash chains for the longest match, with a one-step lazy check
+ * so a literal is emitted when the next position matches longer.
+ */
+
+#ifndef LZPACK_H
+#define LZPACK_H
+
+#include <stdlib.h>
+#include <string.h>
+#include "../../lz.h"
+
+#define LZ_HASH_BITS 14
+#define LZ_CHAIN_DEPTH 256
+#define LZSS_WINDOW 4096
+#define LZSS_MIN 3
+#define LZSS_MAX 18
+#define LZ4_WINDOW 65535
+#define LZ4_MIN 4
+
+typedef struct {
+	int head[1 << LZ_HASH_BITS];
+	int *prev;
+	const unsigned char *src;
+	int size;
+} LzMatcher;
+
+unsigned int lzHash(const unsigned char *p) {
+	return ((p[0] << 16 | p[1] << 8 | p[2]) * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+void lzMatcherInit(LzMatcher *m, const unsigned char *src, int size) {
+	int i;
+	for (i = 0; i < (1 << LZ_HASH_BITS); i++) m->head[i] = -1;
+	m->prev = malloc((size ? size : 1) * sizeof(int));
+	m->src = src;
+	m->size = size;
+}
+
+// Adds position pos to the chains, the positions are inserted in order
+void lzInsert(LzMatcher *m, int pos) {
+	unsigned int h;
+	if (pos + 3 > m->size) return;
+	h = lzHash(m->src + pos);
+	m->prev[pos] = m->head[h];
+	m->head[h] = pos;
+}
+
+// Longest match for pos within window, up to maxLength; returns its length
+int lzFind(LzMatcher *m, int pos, int window, int maxLength, int *distance) {
+	const unsigned char *s = m->src;
+	int candidate, length, best = 0, depth = LZ_CHAIN_DEPTH;
+	if (pos + 3 > m->size) return 0;
+	if (maxLength > m->size - pos) maxLength = m->size - pos;
+	candidate = m->head[lzHash(s + pos)];
+	while (candidate >= 0 && pos - candidate <= window && depth--) {
+		if (candidate < pos && s[candidate + best] == s[pos + best]) {
+			for (length = 0; length < maxLength && s[candidate + length] == s[pos + length]; length++);
+			if (length > best) {
+				best = length;
+				*distance = pos - candidate;
+				if (best == maxLength) break;
+			}
+		}
+		candidate = m->prev[candidate];
+	}
+	return best;
+}
+
+// Both compressors return the packed size; out needs size + size / 8 + 16 bytes
+int lzssEncode(const unsigned char *src, int size, unsigned char *out) {
+	LzMatcher *m = malloc(sizeof(LzMatcher));
+	int pos = 0, n = 0, flagAt = 0, bit = 8, length, distance = 0, next, nextDistance, i;
+
+	lzMatcherInit(m, src, size);
+	while (pos < size) {
+		if (bit == 8) {
+			flagAt = n++;
+			out[flagAt] = 0;
+			bit = 0;
+		}
+		length = lzFind(m, pos, LZSS_WINDOW, LZSS_MAX, &distance);
+		if (length >= LZSS_MIN) {
+			lzInsert(m, pos);
+			next = lzFind(m, pos + 1, LZSS_WINDOW, LZSS_MAX, &nextDistance);
+			if (next > length) length = 0; // lazy: a literal, then the longer match
+		} else {
+			lzInsert(m, pos);
+		}
+		if (length < LZSS_MIN) {
+			out[flagAt] |= 1 << bit;
+			out[n++] = src[pos++];
+		} else {
+			out[n++] = (distance - 1) & 0xff;
+			out[n++] = ((distance - 1) >> 4 & 0xf0) | (length - LZSS_MIN);
+			for (i = 1; i < length; i++) lzInsert(m, pos + i);
+			pos += length;
+		}
+		bit++;
+	}
+	free(m->prev);
+	free(m);
+	return n;
+}
+
+int lz4Length(unsigned char *out, int n, int length) {
+	while (length >= 255) {
+		out[n++] = 255;
+		length -= 255;
+	}
+	out[n++] = length;
+	return n;
+}
+
+int lz4Encode(const unsigned char *src, int size, unsigned char *out) {
+	LzMatcher *m = malloc(sizeof(LzMatcher));
+	int pos = 0, n = 0, anchor = 0, literal, length, distance = 0, next, nextDistance, i, token;
+
+	lzMatcherInit(m, src, size);
+	for (;;) {
+		length = 0;
+		if (pos < size) {
+			length = lzFind(m, pos, LZ4_WINDOW, 0x7fffffff, &distance);
+			lzInsert(m, pos);
+			if (length >= LZ4_MIN) {
+				next = lzFind(m, pos + 1, LZ4_WINDOW, 0x7fffffff, &nextDistance);
+				if (next > length + 1) length = 0; // lazy: a literal, then the longer match
+			}
+			if (length < LZ4_MIN) {
+				pos++;
+				continue;
+			}
+		}
+		// the literals since the last match, then the match (none at the end)
+		literal = pos - anchor;
+		token = n++;
+		out[token] = (literal < 15 ? literal : 15) << 4;
+		if (literal >= 15) n = lz4Length(out, n, literal - 15);
+		memcpy(out + n, src + anchor, literal);
+		n += literal;
+		if (pos == size) break;
+		out[n++] = distance & 0xff;
+		out[n++] = distance >> 8;
+		out[token] |= length - LZ4_MIN < 15 ? length - LZ4_MIN : 15;
+		if (length - LZ4_MIN >= 15) n = lz4Length(out, n, length - LZ4_MIN - 15);
+		for (i = 1; i < length; i++) lzInsert(m, pos + i);
+		pos += length;
+		anchor = pos;
+	}
+	free(m->prev);
+	free(m);
+	return n;
+}
+
+// How far past the start of the output buffer the packed data has to begin
+// for an in-place decode: the most the output ever gets ahead of the input
+int lzMargin(int method, const unsigned char *src, int size) {
+	int in = 0, out = 0, margin = 0, length, v, bit = 8, flags = 0;
+	while (out < size) {
+		if (method == LZ_LZSS) {
+			if (bit == 8) {
+				flags = src[in++];
+				bit = 0;
+			}
+			if (flags >> bit++ & 1) {
+				in++;
+				out++;
+			} else {
+				out += (src[in + 1] & 0x0f) + 3;
+				in += 2;
+			}
+		} else {
+			v = src[in++];
+			length = v >> 4;
+			if (length == 15) {
+				do length += src[in]; while (src[in++] == 255);
+			}
+			in += length;
+			out += length;
+			if (out < size) {
+				in += 2;
+				length = v & 15;
+				if (length == 15) {
+					do length += src[in]; while (src[in++] == 255);
+				}
+				out += length + 4;
+			}
+		}
+		if (out - in > margin) margin = out - in;
+	}
+	return margin;
+}
+
+#endif
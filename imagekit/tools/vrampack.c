@@ -0,0 +1,88 @@
+/*
+ * vrampack.c
+ *
+ * Packs textures and CLUTs into the free VRAM left next to the display
+ * buffers and writes the placement manifest used by vram.h.
+ *
+ *   vrampack [-o layout.h] [-r x,y,w,h]... name:width:height:bpp ...
+ *
+ * width and height are in texels. Every 4 and 8-bit image gets a CLUT item
+ * named <name>_clut. The placements are printed one per line as
+ * "name x y w h" for the conversion scripts. The display buffers
+ * (0,0,320,512) and the debug font (960,256,64,256) are reserved unless
+ * -n is given.
+ *
+ * Build: cc -O2 -o vrampack vrampack.c
+ */
+
+#include "vrampack.h"
+
+#define MAX_ITEMS 512
+
+PackItem items[MAX_ITEMS];
+Packer packer;
+
+void usage() {
+	fprintf(stderr, "usage: vrampack [-o layout.h] [-n] [-r x,y,w,h]... name:width:height:bpp ...\n");
+	exit(1);
+}
+
+int main(int argc, char **argv) {
+	int i, count = 0, failed, bpp, w, h, reserveDefaults = 1, reserveCount = 0;
+	char *layout = NULL, name[58];
+	PackRect reserve[32];
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+			layout = argv[++i];
+		} else if (!strcmp(argv[i], "-n")) {
+			reserveDefaults = 0;
+		} else if (!strcmp(argv[i], "-r") && i + 1 < argc && reserveCount < 30) {
+			PackRect *r = &reserve[reserveCount++];
+			if (sscanf(argv[++i], "%d,%d,%d,%d", &r->x, &r->y, &r->w, &r->h) != 4) usage();
+		} else if (sscanf(argv[i], "%57[^:]:%d:%d:%d", name, &w, &h, &bpp) == 4) {
+			if (count + 2 > MAX_ITEMS) {
+				fprintf(stderr, "vrampack: too many images\n");
+				return 1;
+			}
+			if (bpp != 4 && bpp != 8 && bpp != 16) usage();
+			strcpy(items[count].name, name);
+			items[count].w = packPixelWidth(w, bpp);
+			items[count].h = h;
+			items[count].mode = packModeFromBpp(bpp);
+			count++;
+			if (bpp != 16) {
+				snprintf(items[count].name, sizeof(items[count].name), "%s_clut", name);
+				items[count].w = bpp == 4 ? 16 : 256;
+				items[count].h = 1;
+				items[count].mode = PACK_CLUT;
+				count++;
+			}
+		} else {
+			usage();
+		}
+	}
+
+	packInit(&packer);
+	if (reserveDefaults) {
+		reserve[reserveCount].x = 0; reserve[reserveCount].y = 0;
+		reserve[reserveCount].w = 320; reserve[reserveCount].h = 512;
+		reserveCount++;
+		reserve[reserveCount].x = 960; reserve[reserveCount].y = 256;
+		reserve[reserveCount].w = 64; reserve[reserveCount].h = 256;
+		reserveCount++;
+	}
+	for (i = 0; i < reserveCount; i++) packOccupy(&packer, &reserve[i]);
+
+	failed = packAll(&packer, items, count);
+	for (i = 0; i < count; i++) {
+		if (items[i].x < 0) fprintf(stderr, "vrampack: no room for %s (%dx%d)\n", items[i].name, items[i].w, items[i].h);
+		else printf("%s %d %d %d %d\n", items[i].name, items[i].x, items[i].y, items[i].w, items[i].h);
+	}
+	if (failed) return 1;
+	if (layout && !packWriteLayout(layout, items, count)) {
+		fprintf(stderr, "vrampack: cannot write %s\n", layout);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,194 @@
+/*
+ * vrampack.h
+ *
+ * MaxRects packer for the PlayStation VRAM (1024x512 16-bit pixels), shared
+ * by the image tools. Textures are kept inside the 256x256 texel window of
+ * the texture page they start in, CLUTs on 16 pixel boundaries, so nothing
+ * the runtime loads straddles a page.
+ */
+
+#ifndef VRAMPACK_H
+#define VRAMPACK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PACK_VRAM_WIDTH 1024
+#define PACK_VRAM_HEIGHT 512
+#define PACK_MAX_FREE 4096
+#define PACK_CLUT -1 // mode of a CLUT rectangle, textures use 0/1/2 as in GetTPage()
+
+typedef struct {
+	int x, y, w, h;
+} PackRect;
+
+typedef struct {
+	char name[64];
+	int w, h;   // in VRAM pixels
+	int mode;   // 0 = 4-bit, 1 = 8-bit, 2 = 16-bit, PACK_CLUT
+	int x, y;   // placement, -1 when it did not fit
+	int order;  // position in the input
+} PackItem;
+
+typedef struct {
+	PackRect free[PACK_MAX_FREE];
+	int freeCount;
+} Packer;
+
+// Width in VRAM pixels of a texture of w texels
+int packPixelWidth(int w, int bpp) {
+	return (w * bpp + 15) / 16;
+}
+
+int packModeFromBpp(int bpp) {
+	return bpp == 4 ? 0 : bpp == 8 ? 1 : 2;
+}
+
+int packFits(int x, int y, int w, int h, int mode) {
+	if (x < 0 || y < 0 || x + w > PACK_VRAM_WIDTH || y + h > PACK_VRAM_HEIGHT) return 0;
+	if (mode == PACK_CLUT) return (x & 15) == 0;
+	return (x & 63) + w <= (64 << mode) && (y & 255) + h <= 256;
+}
+
+void packInit(Packer *p) {
+	p->free[0].x = 0;
+	p->free[0].y = 0;
+	p->free[0].w = PACK_VRAM_WIDTH;
+	p->free[0].h = PACK_VRAM_HEIGHT;
+	p->freeCount = 1;
+}
+
+int packContains(PackRect *a, PackRect *b) {
+	return b->x >= a->x && b->y >= a->y && b->x + b->w <= a->x + a->w && b->y + b->h <= a->y + a->h;
+}
+
+// Cuts r out of every free rectangle it touches (the MaxRects split), then
+// drops the free rectangles contained in another one
+void packOccupy(Packer *p, PackRect *r) {
+	static PackRect next[PACK_MAX_FREE];
+	int i, j, n = 0;
+	PackRect f, add[4];
+	int adds;
+
+	for (i = 0; i < p->freeCount; i++) {
+		f = p->free[i];
+		if (r->x >= f.x + f.w || r->x + r->w <= f.x || r->y >= f.y + f.h || r->y + r->h <= f.y) {
+			next[n++] = f;
+			continue;
+		}
+		adds = 0;
+		if (r->x > f.x) { add[adds].x = f.x; add[adds].y = f.y; add[adds].w = r->x - f.x; add[adds].h = f.h; adds++; }
+		if (r->x + r->w < f.x + f.w) { add[adds].x = r->x + r->w; add[adds].y = f.y; add[adds].w = f.x + f.w - r->x - r->w; add[adds].h = f.h; adds++; }
+		if (r->y > f.y) { add[adds].x = f.x; add[adds].y = f.y; add[adds].w = f.w; add[adds].h = r->y - f.y; adds++; }
+		if (r->y + r->h < f.y + f.h) { add[adds].x = f.x; add[adds].y = r->y + r->h; add[adds].w = f.w; add[adds].h = f.y + f.h - r->y - r->h; adds++; }
+		for (j = 0; j < adds && n < PACK_MAX_FREE; j++) next[n++] = add[j];
+	}
+
+	p->freeCount = 0;
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < n; j++) {
+			if (i == j || !packContains(&next[j], &next[i])) continue;
+			// of two identical rectangles keep the first
+			if (packContains(&next[i], &next[j]) && i < j) continue;
+			break;
+		}
+		if (j == n) p->free[p->freeCount++] = next[i];
+	}
+}
+
+// Tries the corners of a free rectangle, nudged onto the next texture page
+// (or 16 pixel CLUT) boundary when the corner itself breaks the constraints.
+// CLUTs try the bottom corners first, textures the top ones.
+int packCandidate(PackRect *f, PackItem *item, int *x, int *y) {
+	int xs[3], ys[3], i, j;
+	xs[0] = item->mode == PACK_CLUT ? (f->x + 15) & ~15 : f->x;
+	xs[1] = (f->x + 63) & ~63;
+	xs[2] = (f->x + f->w - item->w) & (item->mode == PACK_CLUT ? ~15 : ~0);
+	ys[0] = item->mode == PACK_CLUT ? f->y + f->h - item->h : f->y;
+	ys[1] = (f->y + 255) & ~255;
+	ys[2] = f->y;
+	for (j = 0; j < 3; j++) {
+		for (i = 0; i < 3; i++) {
+			if (xs[i] < f->x || ys[j] < f->y) continue;
+			if (xs[i] + item->w > f->x + f->w || ys[j] + item->h > f->y + f->h) continue;
+			if (!packFits(xs[i], ys[j], item->w, item->h, item->mode)) continue;
+			*x = xs[i];
+			*y = ys[j];
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// MaxRects, bottom-left rule: textures go to the topmost then leftmost
+// corner, CLUTs to the bottommost then leftmost one, so the one-line CLUTs
+// collect at the bottom of VRAM instead of cutting through texture space
+int packPlace(Packer *p, PackItem *item) {
+	int i, x, y, better;
+	PackRect r;
+	item->x = item->y = -1;
+	for (i = 0; i < p->freeCount; i++) {
+		if (!packCandidate(&p->free[i], item, &x, &y)) continue;
+		if (item->x < 0) better = 1;
+		else if (y != item->y) better = item->mode == PACK_CLUT ? y > item->y : y < item->y;
+		else better = x < item->x;
+		if (!better) continue;
+		item->x = x;
+		item->y = y;
+	}
+	if (item->x < 0) return 0;
+	r.x = item->x;
+	r.y = item->y;
+	r.w = item->w;
+	r.h = item->h;
+	packOccupy(p, &r);
+	return 1;
+}
+
+// Textures before CLUTs, then biggest side first
+int packCompare(const void *a, const void *b) {
+	const PackItem *ia = a, *ib = b;
+	int sa = ia->w > ia->h ? ia->w : ia->h;
+	int sb = ib->w > ib->h ? ib->w : ib->h;
+	if ((ia->mode == PACK_CLUT) != (ib->mode == PACK_CLUT)) return ia->mode == PACK_CLUT ? 1 : -1;
+	if (sa != sb) return sb - sa;
+	return ia->order - ib->order;
+}
+
+int packOrderCompare(const void *a, const void *b) {
+	return ((const PackItem *)a)->order - ((const PackItem *)b)->order;
+}
+
+// Places every item, biggest first. Returns the number that did not fit;
+// items come back in their input order.
+int packAll(Packer *p, PackItem *items, int count) {
+	int i, failed = 0;
+	for (i = 0; i < count; i++) items[i].order = i;
+	qsort(items, count, sizeof(PackItem), packCompare);
+	for (i = 0; i < count; i++) {
+		if (!packPlace(p, &items[i])) failed++;
+	}
+	qsort(items, count, sizeof(PackItem), packOrderCompare);
+	return failed;
+}
+
+// Writes the placement manifest the runtime reads in vram.h
+int packWriteLayout(const char *path, PackItem *items, int count) {
+	int i;
+	FILE *f = fopen(path, "w");
+	if (!f) return 0;
+	fprintf(f, "// VRAM placement manifest, generated by imagekit/tools/vrampack. Do not edit.\n");
+	fprintf(f, "#define VRAM_LAYOUT_COUNT %d\n", count);
+	fprintf(f, "short vramLayout[VRAM_LAYOUT_COUNT ? VRAM_LAYOUT_COUNT : 1][4] = {\n");
+	for (i = 0; i < count; i++) {
+		fprintf(f, "\t{ %d, %d, %d, %d }%s // %s\n", items[i].x, items[i].y, items[i].w, items[i].h,
+			i + 1 < count ? "," : "", items[i].name);
+	}
+	if (!count) fprintf(f, "\t{ 0, 0, 0, 0 }\n");
+	fprintf(f, "};\n");
+	fclose(f);
+	return 1;
+}
+
+#endif
@@ -0,0 +1,398 @@
+/*
+ * xaenc.c
+ *
+ * Encodes music tracks to XA-ADPCM and interleaves them into one file for
+ * the CD-ROM XA path (music.h), and writes the header with the track list.
+ *
+ *   xaenc -o MUSIC.XA [-H tracks.h] [-r 37800|18900] [-s] [-1] [name=]file...
+ *
+ * A track is a 16-bit PCM WAV or a VAG. Every track gets a channel of its
+ * own and the file goes round the channels a sector at a time, so the drive,
+ * reading the whole file at its full rate, hands each channel to the SPU at
+ * the rate it plays at. A sector holds 4032 4-bit samples and double speed
+ * reads 150 sectors a second: 37.8 kHz mono takes 1 sector in 16, -s stereo
+ * 1 in 8, 18.9 kHz half as many and -1 (single speed) half again. Switching
+ * tracks is a new channel filter without a seek, and the tracks stay in
+ * step, sector k of one next to sector k of all the others. Channels
+ * without a track and the end of the shorter tracks are silence.
+ *
+ * The output is raw 2336-byte Mode 2 Form 2 sectors (subheader, 2324 bytes
+ * of audio, an EDC left for discbuild to fill in), which discbuild puts on
+ * the disc as they are for a name ending in .XA.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define XA_SECTOR 2336
+#define XA_GROUPS 18             // sound groups of 128 bytes in a sector
+#define XA_SAMPLES 4032          // 4-bit samples in a sector, 18 * 8 * 28
+#define XA_CHANNEL_MAX 32
+#define XA_FILE_NUMBER 1
+#define XA_NAME_MAX 16
+#define SUBMODE_AUDIO 0x64       // real time, Form 2, audio
+#define SUBMODE_EOF 0x81         // end of record and of file, on the last sector
+
+typedef struct {
+	char name[XA_NAME_MAX];
+	const char *path;
+	short *pcm;                  // interleaved at the output rate and channels
+	long frames;
+	long sectors;                // of its channel
+} XaTrack;
+
+typedef struct {
+	int s1, s2;                  // the last two decoded samples
+} XaState;
+
+XaTrack tracks[XA_CHANNEL_MAX];
+int trackCount;
+int rate = 37800;
+int stereo;
+int speed = 2;
+
+// XA has the first four of the SPU's five prediction filters
+static const int filterK0[5] = { 0, 60, 115, 98, 122 };
+static const int filterK1[5] = { 0, 0, -52, -55, -60 };
+
+int clamp16(int v) {
+	return v < -32768 ? -32768 : v > 32767 ? 32767 : v;
+}
+
+unsigned long get32(const unsigned char *p) {
+	return p[0] | p[1] << 8 | p[2] << 16 | (unsigned long)p[3] << 24;
+}
+
+unsigned long get32be(const unsigned char *p) {
+	return (unsigned long)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+/* ---- input ---- */
+
+unsigned char *readFile(const char *path, long *size) {
+	FILE *f = fopen(path, "rb");
+	unsigned char *data;
+	if (!f) return NULL;
+	fseek(f, 0, SEEK_END);
+	*size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	data = malloc(*size ? *size : 1);
+	if (fread(data, 1, *size, f) != (size_t)*size) {
+		free(data);
+		data = NULL;
+	}
+	fclose(f);
+	return data;
+}
+
+// 16-bit PCM, returns the interleaved samples
+short *readWav(const unsigned char *data, long size, int *channels, int *srcRate, long *frames) {
+	const unsigned char *p = data + 12, *end = data + size;
+	short *pcm;
+	long chunk, i;
+	int bits = 0;
+
+	*channels = 0;
+	while (p + 8 <= end) {
+		chunk = get32(p + 4);
+		if (!memcmp(p, "fmt ", 4) && chunk >= 16) {
+			if ((p[8] | p[9] << 8) != 1) return NULL; // PCM only
+			*channels = p[10] | p[11] << 8;
+			*srcRate = get32(p + 12);
+			bits = p[22] | p[23] << 8;
+		} else if (!memcmp(p, "data", 4) && *channels && bits == 16) {
+			if (p + 8 + chunk > end) chunk = end - p - 8;
+			*frames = chunk / 2 / *channels;
+			pcm = malloc((*frames * *channels + 1) * sizeof(short));
+			for (i = 0; i < *frames * *channels; i++) pcm[i] = (short)(p[8 + i * 2] | p[9 + i * 2] << 8);
+			return pcm;
+		}
+		p += 8 + chunk + (chunk & 1);
+	}
+	return NULL;
+}
+
+// SPU ADPCM, mono: 16-byte frames of a shift/filter byte, a flag byte and 28
+// samples, low nibble first
+short *readVag(const unsigned char *data, long size, int *srcRate, long *frames) {
+	long bytes = get32be(data + 12), i, n = 0;
+	const unsigned char *p;
+	short *pcm;
+	int s1 = 0, s2 = 0, j, shift, filter, v;
+
+	*srcRate = get32be(data + 16);
+	if (bytes > size - 0x30) bytes = size - 0x30;
+	pcm = malloc((bytes / 16 * 28 + 1) * sizeof(short));
+	for (i = 0; i + 16 <= bytes; i += 16) {
+		p = data + 0x30 + i;
+		shift = p[0] & 15;
+		filter = p[0] >> 4;
+		if (filter > 4) filter = 0;
+		for (j = 0; j < 28; j++) {
+			v = (short)((p[2 + j / 2] >> (j & 1) * 4 & 15) << 12) >> shift;
+			v = clamp16(v + ((s1 * filterK0[filter] + s2 * filterK1[filter] + 32) >> 6));
+			s2 = s1;
+			s1 = v;
+			pcm[n++] = v;
+		}
+	}
+	*frames = n;
+	return pcm;
+}
+
+// Linear interpolation to the output rate, mixed down to mono or spread to
+// stereo as the output wants
+short *resample(const short *src, int channels, int srcRate, long srcFrames, long *frames) {
+	int out = stereo ? 2 : 1, c, a, b;
+	long i, at, n = (long)((double)srcFrames * rate / srcRate);
+	short *pcm = malloc((n * out + 1) * sizeof(short));
+	double pos, frac, v;
+
+	for (i = 0; i < n; i++) {
+		pos = (double)i * srcRate / rate;
+		at = (long)pos;
+		frac = pos - at;
+		for (c = 0; c < out; c++) {
+			if (channels == 1 || out == 2) {
+				a = src[at * channels + c % channels];
+				b = at + 1 < srcFrames ? src[(at + 1) * channels + c % channels] : a;
+			} else {
+				a = (src[at * channels] + src[at * channels + 1]) / 2;
+				b = at + 1 < srcFrames ? (src[(at + 1) * channels] + src[(at + 1) * channels + 1]) / 2 : a;
+			}
+			v = a + (b - a) * frac;
+			pcm[i * out + c] = (short)clamp16((int)(v < 0 ? v - 0.5 : v + 0.5));
+		}
+	}
+	*frames = n;
+	return pcm;
+}
+
+int addTrack(const char *arg) {
+	XaTrack *t = &tracks[trackCount];
+	const char *equals = strchr(arg, '='), *base, *dot;
+	unsigned char *data;
+	short *pcm;
+	long size, frames;
+	int i, len, channels = 1, srcRate = 0;
+
+	if (trackCount == XA_CHANNEL_MAX) {
+		fprintf(stderr, "xaenc: more than %d tracks\n", XA_CHANNEL_MAX);
+		return 0;
+	}
+	if (equals) {
+		base = arg;
+		len = (int)(equals - arg);
+		t->path = equals + 1;
+	} else {
+		base = strrchr(arg, '/') ? strrchr(arg, '/') + 1 : arg;
+		dot = strrchr(base, '.');
+		len = dot ? (int)(dot - base) : (int)strlen(base);
+		t->path = arg;
+	}
+	if (len <= 0 || len >= XA_NAME_MAX) {
+		fprintf(stderr, "xaenc: %s: names are 1 to %d characters\n", arg, XA_NAME_MAX - 1);
+		return 0;
+	}
+	memset(t->name, 0, XA_NAME_MAX);
+	for (i = 0; i < len; i++) t->name[i] = tolower((unsigned char)base[i]);
+
+	data = readFile(t->path, &size);
+	if (!data) {
+		fprintf(stderr, "xaenc: cannot read %s\n", t->path);
+		return 0;
+	}
+	if (size >= 44 && !memcmp(data, "RIFF", 4) && !memcmp(data + 8, "WAVE", 4)) {
+		pcm = readWav(data, size, &channels, &srcRate, &frames);
+	} else if (size >= 0x30) {
+		pcm = readVag(data, size, &srcRate, &frames);
+	} else {
+		pcm = NULL;
+	}
+	free(data);
+	if (!pcm || channels < 1 || channels > 2 || srcRate <= 0) {
+		fprintf(stderr, "xaenc: %s is not a 16-bit PCM WAV or a VAG\n", t->path);
+		free(pcm);
+		return 0;
+	}
+	t->pcm = resample(pcm, channels, srcRate, frames, &t->frames);
+	t->sectors = (t->frames * (stereo ? 2 : 1) + XA_SAMPLES - 1) / XA_SAMPLES;
+	free(pcm);
+	trackCount++;
+	return 1;
+}
+
+/* ---- encoder ---- */
+
+// Encodes 28 samples, every stride-th of src, into nibbles with the filter
+// and shift that decode closest to them, and returns the parameter byte
+int encodeUnit(const short *src, int stride, XaState *state, unsigned char *nibbles) {
+	int filter, shift, i, q, step, predicted, decoded, s1, s2, best = 0;
+	long error, bestError = -1;
+	unsigned char trial[28];
+	XaState bestState = *state;
+
+	for (filter = 0; filter < 4; filter++) {
+		for (shift = 0; shift <= 12; shift++) {
+			step = 1 << (12 - shift);
+			s1 = state->s1;
+			s2 = state->s2;
+			error = 0;
+			for (i = 0; i < 28 && (bestError < 0 || error < bestError); i++) {
+				predicted = (s1 * filterK0[filter] + s2 * filterK1[filter] + 32) >> 6;
+				q = src[i * stride] - predicted;
+				q = q >= 0 ? (q + step / 2) / step : -((-q + step / 2) / step);
+				if (q < -8) q = -8;
+				if (q > 7) q = 7;
+				decoded = clamp16(q * step + predicted);
+				error += (long)(src[i * stride] - decoded) * (src[i * stride] - decoded);
+				trial[i] = q & 15;
+				s2 = s1;
+				s1 = decoded;
+			}
+			if (i < 28) continue;
+			if (bestError < 0 || error < bestError) {
+				bestError = error;
+				best = filter << 4 | shift;
+				memcpy(nibbles, trial, 28);
+				bestState.s1 = s1;
+				bestState.s2 = s2;
+			}
+		}
+	}
+	*state = bestState;
+	return best;
+}
+
+// One sector of a track's channel, or silence past its end
+void encodeSector(XaTrack *t, long sector, XaState *states, unsigned char *data) {
+	int channels = stereo ? 2 : 1, group, unit, i, c, param;
+	long first = sector * (XA_SAMPLES / channels), frame;
+	short samples[224];
+	unsigned char *g, nibbles[28];
+
+	memset(data, 0, XA_SECTOR - 8);
+	if (!t || sector >= t->sectors) return;
+	for (group = 0; group < XA_GROUPS; group++) {
+		g = data + group * 128;
+		// the group's 224 samples, interleaved as the track is
+		for (i = 0; i < 224; i++) {
+			frame = first + (group * 224 + i) / channels;
+			c = i % channels;
+			samples[i] = frame < t->frames ? t->pcm[frame * channels + c] : 0;
+		}
+		for (unit = 0; unit < 8; unit++) {
+			// mono: 8 runs of 28 samples; stereo: left and right take turns
+			if (channels == 1) param = encodeUnit(samples + unit * 28, 1, &states[0], nibbles);
+			else param = encodeUnit(samples + (unit >> 1) * 56 + (unit & 1), 2, &states[unit & 1], nibbles);
+			g[unit < 4 ? unit : unit + 4] = param;
+			g[unit < 4 ? unit + 4 : unit + 8] = param;
+			for (i = 0; i < 28; i++) g[16 + i * 4 + (unit >> 1)] |= nibbles[i] << (unit & 1) * 4;
+		}
+	}
+}
+
+/* ---- output ---- */
+
+int interleave() {
+	return speed * 75 * XA_SAMPLES / (rate * (stereo ? 2 : 1));
+}
+
+int writeXa(const char *path, long length) {
+	FILE *f = fopen(path, "wb");
+	XaState states[XA_CHANNEL_MAX][2];
+	unsigned char sector[XA_SECTOR];
+	int channels = interleave(), c, ok = 1;
+	long k;
+
+	if (!f) return 0;
+	memset(states, 0, sizeof(states));
+	for (k = 0; k < length && ok; k++) {
+		for (c = 0; c < channels && ok; c++) {
+			sector[0] = sector[4] = XA_FILE_NUMBER;
+			sector[1] = sector[5] = c;
+			sector[2] = sector[6] = k + 1 == length && c + 1 == channels ? SUBMODE_AUDIO | SUBMODE_EOF : SUBMODE_AUDIO;
+			sector[3] = sector[7] = (stereo ? 1 : 0) | (rate == 18900 ? 4 : 0);
+			encodeSector(c < trackCount ? &tracks[c] : NULL, k, states[c], sector + 8);
+			ok = fwrite(sector, 1, XA_SECTOR, f) == XA_SECTOR;
+		}
+	}
+	return fclose(f) == 0 && ok;
+}
+
+int writeIndex(const char *path, long length) {
+	FILE *f = fopen(path, "w");
+	int i, j;
+	if (!f) return 0;
+	fprintf(f, "// XA music tracks, generated by imagekit/tools/xaenc. Do not edit.\n");
+	fprintf(f, "#define MUSIC_TRACK_COUNT %d\n", trackCount);
+	fprintf(f, "#define MUSIC_INTERLEAVE %d // sectors, one of each channel\n", interleave());
+	fprintf(f, "#define MUSIC_FILE_NUMBER %d\n", XA_FILE_NUMBER);
+	fprintf(f, "#define MUSIC_DOUBLE_SPEED %d\n", speed == 2);
+	fprintf(f, "#define MUSIC_LENGTH %ld // sectors of every channel\n", length);
+	for (i = 0; i < trackCount; i++) {
+		fprintf(f, "#define TRACK_");
+		for (j = 0; tracks[i].name[j]; j++) fputc(isalnum((unsigned char)tracks[i].name[j]) ? toupper((unsigned char)tracks[i].name[j]) : '_', f);
+		fprintf(f, " %d // %.1f s\n", i, (double)tracks[i].frames / rate);
+	}
+	fprintf(f, "short musicTrackLength[MUSIC_TRACK_COUNT ? MUSIC_TRACK_COUNT : 1] = {\n");
+	for (i = 0; i < trackCount; i++) fprintf(f, "\t%ld%s // %s\n", tracks[i].sectors, i + 1 < trackCount ? "," : "", tracks[i].name);
+	if (!trackCount) fprintf(f, "\t0\n");
+	fprintf(f, "};\n");
+	return fclose(f) == 0;
+}
+
+void usage() {
+	fprintf(stderr, "usage: xaenc -o MUSIC.XA [-H tracks.h] [-r 37800|18900] [-s] [-1] [name=]file...\n");
+	exit(1);
+}
+
+int main(int argc, char **argv) {
+	const char *output = NULL, *index = NULL;
+	long length = 0;
+	int i, first = 0;
+
+	// the options first, wherever they are: a track is resampled as it is read
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-o") && i + 1 < argc) output = argv[++i];
+		else if (!strcmp(argv[i], "-H") && i + 1 < argc) index = argv[++i];
+		else if (!strcmp(argv[i], "-r") && i + 1 < argc) rate = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-s")) stereo = 1;
+		else if (!strcmp(argv[i], "-1")) speed = 1;
+		else if (argv[i][0] == '-') usage();
+		else if (!first) first = i;
+	}
+	if (!output || !first || (rate != 37800 && rate != 18900)) usage();
+	for (i = first; i < argc; i++) {
+		if (argv[i][0] == '-') {
+			if (strcmp(argv[i], "-s") && strcmp(argv[i], "-1")) i++;
+			continue;
+		}
+		if (!addTrack(argv[i])) return 1;
+	}
+	if (trackCount > interleave()) {
+		fprintf(stderr, "xaenc: %d tracks, the interleave only has %d channels\n", trackCount, interleave());
+		return 1;
+	}
+	for (i = 0; i < trackCount; i++) {
+		if (tracks[i].sectors > length) length = tracks[i].sectors;
+	}
+
+	if (!writeXa(output, length)) {
+		fprintf(stderr, "xaenc: cannot write %s\n", output);
+		return 1;
+	}
+	if (index && !writeIndex(index, length)) {
+		fprintf(stderr, "xaenc: cannot write %s\n", index);
+		return 1;
+	}
+	for (i = 0; i < trackCount; i++) {
+		printf("%-15s channel %2d  %6.1f s  %5ld sectors  %s\n", tracks[i].name, i, (double)tracks[i].frames / rate,
+			tracks[i].sectors, tracks[i].path);
+	}
+	printf("%d Hz %s, 1 sector in %d, %ld sectors, %.1f MB\n", rate, stereo ? "stereo" : "mono", interleave(),
+		length * interleave(), length * interleave() * (double)XA_SECTOR / (1024 * 1024));
+	return 0;
+}
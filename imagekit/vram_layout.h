@@ -0,0 +1,7 @@
+// VRAM placement manifest, generated by imagekit/tools/vrampack. Do not edit.
+#define VRAM_LAYOUT_COUNT 3
+short vramLayout[VRAM_LAYOUT_COUNT ? VRAM_LAYOUT_COUNT : 1][4] = {
+	{ 320, 0, 13, 30 }, // img_enemy
+	{ 333, 0, 8, 24 }, // img_ship
+	{ 320, 511, 256, 1 } // img_enemy_clut
+};
@@ -0,0 +1,356 @@
+/*
+ * loader.h
+ *
+ * Background loading from the CD archive (archive.h). Requests wait in a
+ * queue and the most urgent one is read next, LOADER_CHUNK sectors at a
+ * time into two chunk buffers: CdReadCallback starts reading the next chunk
+ * into the other buffer as soon as one is full, while loaderUpdate(), once a
+ * frame, hands the full ones to the request's upload path (a heap copy, then
+ * VRAM, or straight into SPU RAM through sound.h's upload queue, which keeps
+ * the buffer until its DMA is done). The game keeps rendering while an asset
+ * streams in. A request is read to the end before the next one starts, so
+ * priorities never cost a seek in the middle of a file.
+ *
+ * Packed entries are read like stored ones and decoded in place once the
+ * last chunk is in (see archiveLoad()), so they always take the heap path.
+ *
+ * Call loaderSync() before using the blocking archiveLoad(), both drive the
+ * same CD.
+ */
+
+#ifndef LOADER_H
+#define LOADER_H
+
+#define LOADER_CHUNK 8      // sectors per CdRead, 16 KB per buffer
+#define LOADER_QUEUE_MAX 16
+#define LOADER_RETRIES 4
+
+// Request states
+#define LOAD_FREE 0
+#define LOAD_QUEUED 1
+#define LOAD_READING 2
+#define LOAD_DONE 3
+#define LOAD_FAILED 4
+
+// Chunk buffer states
+#define LOADER_BUFFER_FREE 0
+#define LOADER_BUFFER_READING 1
+#define LOADER_BUFFER_FULL 2
+#define LOADER_BUFFER_UPLOADING 3 // an SPU transfer still reads it
+
+typedef struct LoadRequest LoadRequest;
+typedef void (*LoadChunk)(LoadRequest *r, unsigned char *data, int offset, int bytes);
+typedef void (*LoadCallback)(LoadRequest *r);
+
+struct LoadRequest {
+	volatile int state;
+	int entry;          // in the archive
+	int priority;       // the highest is read first
+	int order;          // first come first served within a priority
+	int size;           // bytes read from the disc, packed
+	int readOffset;     // bytes asked from the drive so far
+	int packOffset;     // where the heap path puts the packed data in r->data
+	int retries;
+	LoadChunk chunk;    // upload path, called for every chunk in order
+	LoadCallback start; // allocates the destination, sets state to LOAD_FAILED when it cannot
+	LoadCallback done;  // after the last chunk
+	LoadCallback notify; // the caller's completion callback, may be NULL
+	unsigned char *data; // heap copy of a texture or raw load
+	unsigned long spuAddr;
+	int sample;         // sound.h descriptor a sound load fills in
+	Texture *texture;
+	void *user;
+};
+
+typedef struct {
+	volatile int state;
+	int request;
+	int offset; // in the entry
+	int bytes;
+	unsigned long data[LOADER_CHUNK * ARCHIVE_SECTOR / 4];
+} LoaderBuffer;
+
+LoadRequest loadQueue[LOADER_QUEUE_MAX];
+LoaderBuffer loaderBuffers[2];
+volatile int loaderReading;   // a CdRead is in flight
+volatile int loaderRequest;   // request being read, -1 when none
+int loaderNext;               // buffer the next chunk is read into
+int loaderConsume;            // buffer handed over next
+int loaderOrder;
+
+// Starts reading the next chunk of the current request if the buffer it goes
+// into is free. Runs in the read callback as well as in loaderUpdate(), so it
+// only uses the non-blocking CdControlF().
+void loaderKick() {
+	LoadRequest *r;
+	LoaderBuffer *b = &loaderBuffers[loaderNext];
+	CdlLOC loc;
+	int sectors;
+
+	if (loaderReading || loaderRequest < 0 || b->state != LOADER_BUFFER_FREE) return;
+	r = &loadQueue[loaderRequest];
+	if (r->state != LOAD_READING || r->readOffset >= r->size) return;
+
+	sectors = (r->size - r->readOffset + ARCHIVE_SECTOR - 1) / ARCHIVE_SECTOR;
+	if (sectors > LOADER_CHUNK) sectors = LOADER_CHUNK;
+	b->request = loaderRequest;
+	b->offset = r->readOffset;
+	b->bytes = sectors * ARCHIVE_SECTOR;
+	if (b->offset + b->bytes > r->size) b->bytes = r->size - b->offset;
+	b->state = LOADER_BUFFER_READING;
+	r->readOffset += b->bytes;
+	loaderReading = 1;
+
+	CdIntToPos(archiveSector + archiveEntries[r->entry].sector + b->offset / ARCHIVE_SECTOR, &loc);
+	CdControlF(CdlSetloc, (u_char *)&loc);
+	if (!CdRead(sectors, b->data, CdlModeSpeed)) {
+		// the drive did not take the command, try again from loaderUpdate()
+		r->readOffset = b->offset;
+		b->state = LOADER_BUFFER_FREE;
+		loaderReading = 0;
+	}
+}
+
+void loaderReadDone(u_char intr, u_char *result) {
+	LoaderBuffer *b = &loaderBuffers[loaderNext];
+	LoadRequest *r;
+
+	if (!loaderReading) return; // a blocking archiveRead()
+	loaderReading = 0;
+	r = &loadQueue[b->request];
+	if (intr != CdlComplete) {
+		b->state = LOADER_BUFFER_FREE;
+		r->readOffset = b->offset;
+		if (++r->retries > LOADER_RETRIES) r->state = LOAD_FAILED;
+		else loaderKick();
+		return;
+	}
+	b->state = LOADER_BUFFER_FULL;
+	loaderNext ^= 1;
+	loaderKick();
+}
+
+void loaderInit() {
+	int i;
+	for (i = 0; i < LOADER_QUEUE_MAX; i++) loadQueue[i].state = LOAD_FREE;
+	loaderBuffers[0].state = loaderBuffers[1].state = LOADER_BUFFER_FREE;
+	loaderReading = 0;
+	loaderRequest = -1;
+	loaderNext = loaderConsume = 0;
+	CdReadCallback(loaderReadDone);
+}
+
+// Queues an entry, returns the request slot or -1 when the queue is full.
+// chunk, start and done make up the upload path; see the loaderLoad*()
+// helpers below.
+int loaderQueue(int entry, int priority, LoadCallback start, LoadChunk chunk, LoadCallback done, LoadCallback notify) {
+	LoadRequest *r;
+	int i;
+	if (entry < 0 || entry >= archiveCount) return -1;
+	for (i = 0; i < LOADER_QUEUE_MAX; i++) {
+		if (loadQueue[i].state == LOAD_FREE) break;
+	}
+	if (i == LOADER_QUEUE_MAX) return -1;
+	r = &loadQueue[i];
+	r->entry = entry;
+	r->priority = priority;
+	r->order = loaderOrder++;
+	r->size = archiveEntries[entry].packed;
+	r->readOffset = 0;
+	r->packOffset = 0;
+	r->retries = 0;
+	r->start = start;
+	r->chunk = chunk;
+	r->done = done;
+	r->notify = notify;
+	r->data = NULL;
+	r->spuAddr = SOUND_ADDR_NONE;
+	r->texture = NULL;
+	r->user = NULL;
+	r->state = LOAD_QUEUED;
+	return i;
+}
+
+// Calls the caller back and frees the slot. A failed load gets its heap
+// buffer or SPU memory freed here.
+void loaderFinish(LoadRequest *r) {
+	ArchiveEntry *e = &archiveEntries[r->entry];
+	if (r->state == LOAD_READING) {
+		if (r->data) lzDecode(e->method, r->data + r->packOffset, r->data, e->size);
+		r->state = LOAD_DONE;
+		if (r->done) r->done(r);
+	}
+	if (r->state == LOAD_FAILED && r->data) {
+		free3(r->data);
+		r->data = NULL;
+	}
+	if (r->state == LOAD_FAILED && r->spuAddr != SOUND_ADDR_NONE) {
+		soundRamFree(r->spuAddr);
+		r->spuAddr = SOUND_ADDR_NONE;
+	}
+	if (r->notify) r->notify(r);
+	r->state = LOAD_FREE;
+}
+
+// Picks the queued request with the highest priority and prepares its
+// destination
+void loaderStartNext() {
+	LoadRequest *r;
+	int i, best = -1;
+	for (i = 0; i < LOADER_QUEUE_MAX; i++) {
+		r = &loadQueue[i];
+		if (r->state != LOAD_QUEUED) continue;
+		if (best < 0 || r->priority > loadQueue[best].priority ||
+			(r->priority == loadQueue[best].priority && r->order < loadQueue[best].order)) best = i;
+	}
+	if (best < 0) return;
+	r = &loadQueue[best];
+	r->state = LOAD_READING;
+	archiveTrace(r->entry);
+	if (r->start) r->start(r);
+	if (r->state == LOAD_FAILED || !r->size) {
+		loaderFinish(r);
+		return;
+	}
+	loaderRequest = best;
+}
+
+// Once a frame: hands the full chunks over in read order, retires finished
+// requests, keeps the drive busy and frees the texture buffers the GPU has
+// finished uploading
+void loaderUpdate() {
+	LoaderBuffer *b;
+	LoadRequest *r;
+
+	archiveFreeDone();
+	while ((b = &loaderBuffers[loaderConsume])->state == LOADER_BUFFER_FULL) {
+		r = &loadQueue[b->request];
+		if (r->state == LOAD_READING) r->chunk(r, (unsigned char *)b->data, b->offset, b->bytes);
+		if (b->state == LOADER_BUFFER_FULL) b->state = LOADER_BUFFER_FREE;
+		loaderConsume ^= 1;
+		if (b->offset + b->bytes >= r->size) {
+			if (b->request == loaderRequest) loaderRequest = -1;
+			loaderFinish(r);
+		}
+	}
+	if (loaderRequest >= 0 && loadQueue[loaderRequest].state == LOAD_FAILED && !loaderReading) {
+		// chunks already read for it are dropped on the floor
+		r = &loadQueue[loaderRequest];
+		loaderRequest = -1;
+		soundUploadSync(); // nothing may still read a buffer or write its SPU memory
+		loaderBuffers[0].state = loaderBuffers[1].state = LOADER_BUFFER_FREE;
+		loaderConsume = loaderNext;
+		loaderFinish(r);
+	}
+	if (loaderRequest < 0 && !loaderReading) loaderStartNext();
+	loaderKick();
+}
+
+// Nothing queued, being read or waiting to be handed over
+int loaderIdle() {
+	int i;
+	if (loaderRequest >= 0 || loaderReading) return 0;
+	for (i = 0; i < LOADER_QUEUE_MAX; i++) {
+		if (loadQueue[i].state != LOAD_FREE) return 0;
+	}
+	return 1;
+}
+
+// Waits for every queued request, for loading screens and before archiveLoad()
+void loaderSync() {
+	while (!loaderIdle()) {
+		loaderUpdate();
+		soundUpdate();
+		VSync(0);
+	}
+}
+
+/* ---- upload paths ---- */
+
+void loaderStartHeap(LoadRequest *r) {
+	r->data = malloc3(archiveBufferSize(r->entry, &r->packOffset));
+	if (!r->data) r->state = LOAD_FAILED;
+}
+
+void loaderChunkHeap(LoadRequest *r, unsigned char *data, int offset, int bytes) {
+	memcpy(r->data + r->packOffset + offset, data, bytes);
+}
+
+void loaderDoneTexture(LoadRequest *r) {
+	if (!textureLoad(r->data, r->texture)) r->state = LOAD_FAILED;
+	archiveFreeLater(r->data); // the GPU is still reading it
+	r->data = NULL;
+}
+
+// VAG data goes straight into SPU RAM chunk by chunk, minus the 0x30 byte
+// header. Chunks after the first start 0x30 bytes short of a 64 byte block and
+// DMA rounds every transfer up to whole blocks, so the last one can run up to
+// a block past the data: the allocation has that much slack.
+void loaderStartSound(LoadRequest *r) {
+	r->spuAddr = soundRamAlloc(r->size - 0x30 + SOUND_RAM_ALIGN);
+	if (r->spuAddr == SOUND_ADDR_NONE) r->state = LOAD_FAILED;
+}
+
+// Upload done callback, the buffer can take the next chunk
+void loaderBufferUploaded(void *buffer) {
+	((LoaderBuffer *)buffer)->state = LOADER_BUFFER_FREE;
+}
+
+void loaderChunkSound(LoadRequest *r, unsigned char *data, int offset, int bytes) {
+	LoaderBuffer *b = &loaderBuffers[loaderConsume];
+	int skip = offset < 0x30 ? 0x30 - offset : 0;
+	if (bytes <= skip) return;
+	b->state = LOADER_BUFFER_UPLOADING;
+	soundUpload(r->sample, r->spuAddr + offset + skip - 0x30, data + skip, bytes - skip, loaderBufferUploaded, b);
+}
+
+void loaderDoneSound(LoadRequest *r) {
+	soundSet(r->sample, r->spuAddr, archiveEntries[r->entry].size - 0x30);
+}
+
+// Upload done callback for a decoded VAG
+void loaderHeapUploaded(void *data) {
+	free3(data);
+}
+
+// A packed VAG is decoded on the heap first, then sent in one go
+void loaderDonePackedSound(LoadRequest *r) {
+	int size = archiveEntries[r->entry].size - 0x30;
+	r->spuAddr = soundRamAlloc(size);
+	if (r->spuAddr == SOUND_ADDR_NONE) {
+		r->state = LOAD_FAILED;
+		return;
+	}
+	soundUpload(r->sample, r->spuAddr, r->data + 0x30, size, loaderHeapUploaded, r->data);
+	r->data = NULL;
+	soundSet(r->sample, r->spuAddr, size);
+}
+
+// Reads a TIM and uploads it into VRAM, filling in tex. notify sees the
+// request with state LOAD_DONE or LOAD_FAILED.
+int loaderLoadTexture(int entry, int priority, Texture *tex, LoadCallback notify) {
+	int i = loaderQueue(entry, priority, loaderStartHeap, loaderChunkHeap, loaderDoneTexture, notify);
+	if (i >= 0) loadQueue[i].texture = tex;
+	return i;
+}
+
+// Streams a VAG into SPU RAM for sample (see soundNew()), which plays once
+// the load and its uploads are done (soundReady())
+int loaderLoadSound(int entry, int priority, int sample, LoadCallback notify) {
+	int i;
+	if (entry >= 0 && entry < archiveCount && archiveEntries[entry].method != LZ_NONE) {
+		i = loaderQueue(entry, priority, loaderStartHeap, loaderChunkHeap, loaderDonePackedSound, notify);
+	} else {
+		i = loaderQueue(entry, priority, loaderStartSound, loaderChunkSound, loaderDoneSound, notify);
+	}
+	if (i >= 0) loadQueue[i].sample = sample;
+	return i;
+}
+
+// Reads an entry into a heap buffer; notify owns r->data and hands it back
+// with archiveFree()
+int loaderLoadRaw(int entry, int priority, LoadCallback notify) {
+	return loaderQueue(entry, priority, loaderStartHeap, loaderChunkHeap, NULL, notify);
+}
+
+#endif
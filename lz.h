@@ -0,0 +1,87 @@
+/*
+ * lz.h
+ *
+ * Decompressors for the packed archive entries (imagekit/tools/assetpak
+ * picks a method per entry). Plain C without library calls, so the host
+ * tools build the same code to benchmark it. Written for the R3000: a single
+ * output pointer compared against the end, no bounds checks on the input
+ * (the archive is trusted) and no multiplies; the compiler keeps everything
+ * in registers. Both decode in place when the packed data sits at the end of
+ * the output buffer, at least the entry's margin past its start (see
+ * archiveLoad()).
+ *
+ * LZSS: a flag byte for every 8 items, LSB first, 1 = literal byte, 0 = a
+ * 2-byte match: 12-bit distance - 1 and 4-bit length - 3.
+ *
+ * LZ4 style: a token with the literal count in the high nibble and the
+ * match length - 4 in the low one, 15 meaning more bytes follow (each 255
+ * meaning more again), the literals, then a 16-bit little endian distance.
+ * The data ends after the literals of the last token.
+ */
+
+#ifndef LZ_H
+#define LZ_H
+
+#define LZ_NONE 0
+#define LZ_LZSS 1
+#define LZ_LZ4 2
+
+void lzssDecode(const unsigned char *src, unsigned char *dst, int size) {
+	unsigned char *end = dst + size, *match;
+	unsigned int flags = 0, length;
+
+	while (dst < end) {
+		flags >>= 1;
+		if (!(flags & 0x100)) flags = *src++ | 0xff00; // 8 flag bits with a marker above them
+		if (flags & 1) {
+			*dst++ = *src++;
+			continue;
+		}
+		match = dst - ((src[1] & 0xf0) << 4 | src[0]) - 1;
+		length = (src[1] & 0x0f) + 3;
+		src += 2;
+		do {
+			*dst++ = *match++;
+		} while (--length);
+	}
+}
+
+void lz4Decode(const unsigned char *src, unsigned char *dst, int size) {
+	unsigned char *end = dst + size, *match;
+	unsigned int token, length, v;
+
+	for (;;) {
+		token = *src++;
+		length = token >> 4;
+		if (length == 15) {
+			do {
+				v = *src++;
+				length += v;
+			} while (v == 255);
+		}
+		while (length--) *dst++ = *src++;
+		if (dst >= end) return;
+
+		match = dst - (src[0] | src[1] << 8);
+		src += 2;
+		length = token & 15;
+		if (length == 15) {
+			do {
+				v = *src++;
+				length += v;
+			} while (v == 255);
+		}
+		length += 4;
+		do {
+			*dst++ = *match++;
+		} while (--length);
+	}
+}
+
+// Decodes size bytes of method-packed data from src into dst
+void lzDecode(int method, const unsigned char *src, unsigned char *dst, int size) {
+	if (method == LZ_LZSS) lzssDecode(src, dst, size);
+	else if (method == LZ_LZ4) lz4Decode(src, dst, size);
+}
+
+#endif
@@ -1,109 +1,178 @@
 #include "constants.h"
+#include "entity.h"
+#include "grid.h"
 #include "mekanik.h"
-#include "audio/hit_hurt.h"
-#include "audio/explode.h"
+#include "projectile.h"
+#include "profile.h"
+#include "text.h"
+#include "archive.h"
+#include "loader.h"
+#include "soundbank.h"
+#include "music.h"
 
-Image ship;
-Image enemy;
-Ball playerball;
+#define FIRE_DELAY 8 // frames between two player shots
+
+int ship;
+int enemy;
+int gameSounds[] = { ASSET_HIT_HURT, ASSET_EXPLODE };
+int soundBank;
+int hitSound;
+int explodeSound;
+int fireDelay = 0;
 int x = 0;
 int y = 0;
 int speed = 2;
-char scoreStr[50];
+Text scoreText;
+
+// Reads an image from the archive into the sprite table
+int loadSprite(int asset, int width, int height) {
+    int sprite, size;
+    unsigned char *data = archiveLoad(asset, &size);
+    if (!data) return ENTITY_NONE;
+    sprite = spriteLoad(data, size, width, height);
+    archiveFree(data);
+    return sprite;
+}
+
+// Returns 0 when the sprites the game needs could not be loaded
+int initialize() {
+    unsigned char *data;
+    int enemySprite, shipSprite;
 
-void initialize() {
+    initializeHeap(); // first, scratchAlloc() falls back to it
     initializeScreen();
     initializePad();
     initializeDebugFont();
+    archiveInit();
+    data = archiveLoad(ASSET_FONT, 0);
+    if (data) fontInit(data);
+    archiveFree(data);
+    textInit(&scoreText, 8, 8);
     setBackgroundColor(createColor(0, 0, 16));
     
-    // Initialize images with specific dimensions
-    sprite_create((unsigned char *)img_enemy, 32, 32, &enemy);
-    sprite_create((unsigned char *)img_ship, 32, 32, &ship);
+    // Sprites take the size of their cropped images
+    entityInit();
+    gridInit();
+    enemySprite = loadSprite(ASSET_ENEMY, 0, 0);
+    shipSprite = loadSprite(ASSET_SHIP, 0, 0);
+    if (enemySprite == ENTITY_NONE || shipSprite == ENTITY_NONE) {
+        if (DEBUG) printf("Cannot load the enemy and ship sprites\n");
+        return 0;
+    }
+    enemy = entitySpawn(enemySprite, LAYER_ENEMIES, 0, 0);
+    ship = entitySpawn(shipSprite, LAYER_PLAYER, 0, 0);
+    if (enemy == ENTITY_NONE || ship == ENTITY_NONE) {
+        if (DEBUG) printf("Cannot spawn the enemy and ship\n");
+        return 0;
+    }
     
     // Set initial positions
-    enemy.sprite.x = (SCREEN_WIDTH - enemy.sprite.w) / 2;
-    enemy.sprite.y = 0; // Top of the screen
+    entityX[enemy] = (SCREEN_WIDTH - entityW[enemy]) / 2;
+    entityY[enemy] = 0; // Top of the screen
+
+    entityX[ship] = (SCREEN_WIDTH - entityW[ship]) / 2;
+    entityY[ship] = SCREEN_HEIGHT - entityH[ship]; // Bottom 
 
-    ship.sprite.x = (SCREEN_WIDTH - ship.sprite.w) / 2;
-    ship.sprite.y = SCREEN_HEIGHT - ship.sprite.h; // Bottom 
+    entityCollide[enemy] = COLLIDE_ENEMY;
+    entityCollide[ship] = COLLIDE_PLAYER;
 
+    // the sounds stream in while the game is already running
     audioInit();
-    audioTransferVagToSPU((unsigned char *)hit_hurt, hit_hurt_size, SPU_0CH);
-    audioTransferVagToSPU((unsigned char *)explode, explode_size, SPU_1CH);
+    soundInit();
+    loaderInit();
+    soundBank = soundBankLoad("game", gameSounds, 2, 1);
+    hitSound = soundBankSample(soundBank, 0);
+    explodeSound = soundBankSample(soundBank, 1);
+    if (musicInit()) musicPlay(TRACK_MUSIC); // starts once the bank is read
     scoreboard = createScoreboard();
-    playerball.active = 0; // Initialize as inactive
+    projectileInit();
+    profileInit();
+    return 1;
+}
+
+// Called by projectileUpdate() for every player shot that hits an enemy
+void shotHit(int target) {
+    scoreboard.score++;
+    profileBegin(PROFILE_AUDIO);
+    soundPlay(hitSound, SOUND_PRIORITY_CUE); // every hit gets a voice of its own
+    soundPlay(explodeSound, SOUND_PRIORITY_EFFECT);
+    profileEnd(PROFILE_AUDIO);
 }
 
 void update() {
+    loaderUpdate();
+    profileBegin(PROFILE_AUDIO);
+    soundUpdate();
+    musicUpdate();
+    profileEnd(PROFILE_AUDIO);
     padUpdate();
+    if (padCheckPressed(Pad1Select)) profileOverlay = !profileOverlay;
     // Move enemy based on Player 1 input
     if (padCheck(Pad1Left)) {  // Move left
         x -= speed;
-        enemy = moveImage(enemy, x, enemy.sprite.y); 
+        entityX[enemy] = x;
     }
     if (padCheck(Pad1Right)) { // Move right
         x += speed;
-        enemy = moveImage(enemy, x, enemy.sprite.y); 
+        entityX[enemy] = x;
     }
 
     // Move ship based on Player 1 input
     if (padCheck(Pad1Up)) {
         y -= speed;
-        ship = moveImage(ship, ship.sprite.x, y);
+        entityY[ship] = y;
     }
     if (padCheck(Pad1Down)) {
         y += speed;
-        ship = moveImage(ship, ship.sprite.x, y);
+        entityY[ship] = y;
     }
     if (padCheck(Pad1Left)) {  // Move left
         x -= speed;
-        ship = moveImage(ship, x, ship.sprite.y); 
+        entityX[ship] = x;
     }
     if (padCheck(Pad1Right)) { // Move right
         x += speed;
-        ship = moveImage(ship, x, ship.sprite.y); 
+        entityX[ship] = x;
     }
+    entityUpdate();
+    gridBuild();
 
     // --- Player Shooting ---
-    if (padCheck(Pad1Up) && !playerball.active) {
-        playerball = createBall(ship.sprite.x + ship.sprite.w / 2 - playerball.size / 2, ship.sprite.y - playerball.size, 0, -2); // Shoot upwards
-        playerball.active = 1;
-    }
-    if (playerball.active) {
-        playerball = moveBall(playerball);
+    if (fireDelay > 0) fireDelay--;
+    if (padCheck(Pad1Up) && !fireDelay) {
+        projectileSpawn(entityX[ship] + entityW[ship] / 2 - PROJECTILE_SIZE / 2, entityY[ship] - PROJECTILE_SIZE, 0, -2, COLLIDE_ENEMY); // Shoot upwards
+        fireDelay = FIRE_DELAY;
     }
 
-    // Check collision with enemy (and increase score)
-    if (playerball.active && checkCollision(playerball, enemy)) {
-        scoreboard.score++;
-        playerball.active = 0; // Deactivate projectile
-        audioPlay(SPU_0CH); // Play audio on collision
-        audioPlay(SPU_1CH); // Play audio on collision
-    }
-    
-    // Check if projectile is off-screen
-    if (playerball.y < 0) {
-        playerball.active = 0;
-    }
+    // Move the shots, drop the off-screen ones and score the hits
+    projectileUpdate(shotHit);
 
-    sprintf(scoreStr, "Score: %d", scoreboard.score);
+    textSetInt(&scoreText, "SCORE ", scoreboard.score); // only re-lays the glyphs when the score changed
 }
 
 void draw() {
-    drawImage(ship);
-    drawImage(enemy);
-    FntPrint(scoreStr);  // Use FntPrint for debug font output
-    drawBall(playerball);
+    entityDraw();
+    projectileDraw();
+    textDraw(&scoreText, LAYER_HUD);
+    profileDraw();
 }
 
 int main() {
-    initialize();
+    if (!initialize()) return 0;
 
     while(1) {
+        profileBegin(PROFILE_UPDATE);
         update();
+        profileEnd(PROFILE_UPDATE);
+        profileBegin(PROFILE_WAIT);
         clearDisplay();
+        profileEnd(PROFILE_WAIT);
+        profileBegin(PROFILE_DRAW);
         draw();
+        profileEnd(PROFILE_DRAW);
+        profileBegin(PROFILE_DISPLAY);
         display();
+        profileEnd(PROFILE_DISPLAY);
+        profileEndFrame();
     }
 }
\ No newline at end of file
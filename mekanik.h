@@ -1,11 +1,10 @@
 #ifndef MEKANIK_H
 #define MEKANIK_H
 
+// Collision box, kept apart from whatever is drawn for the object
 typedef struct {
-    int size, x, y, speed_x, speed_y;
-    Box box;
-    int active; // Flag to indicate if the projectile is active
-} Ball;
+    short x, y, w, h;
+} Aabb;
 
 typedef struct {
     int score;
@@ -19,39 +18,9 @@ Scoreboard createScoreboard() {
     return scoreboard;
 }
 
-int checkCollision(Ball ball, Image image) {
-    Box box = ball.box;
-    return !(box.line[0].line.x0 > image.sprite.x + image.sprite.w ||
-             box.line[1].line.x0 < image.sprite.x ||
-             box.line[0].line.y0 > image.sprite.y + image.sprite.h ||
-             box.line[2].line.y0 < image.sprite.y);
-}
-
-Ball createBall(int x, int y, int speed_x, int speed_y) {
-    Ball ball;
-    ball.size = 3;
-    ball.x = x;
-    ball.y = y;
-    ball.box = createBox(createColor(255, 255, 255), ball.x, ball.y, ball.x + ball.size, ball.y + ball.size);
-    ball.active = 1;
-    ball.speed_x = speed_x;
-    ball.speed_y = speed_y;
-    return ball;
-}
-
-Ball moveBall(Ball ball) {
-    if(ball.active){
-	ball.x += ball.speed_x;
-	ball.y += ball.speed_y;
-	ball.box = moveBox(ball.box, ball.x, ball.y);}
-	return ball;
-    
-}
-
-void drawBall(Ball ball) {
-    if (ball.active) {
-        drawBox(ball.box);
-    }
+int checkCollision(Aabb *a, Aabb *b) {
+    return a->x < b->x + b->w && b->x < a->x + a->w &&
+           a->y < b->y + b->h && b->y < a->y + a->h;
 }
 
 #endif
\ No newline at end of file
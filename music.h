@@ -0,0 +1,172 @@
+/*
+ * music.h
+ *
+ * Background music streamed from the disc as XA-ADPCM (MUSIC.XA, from
+ * imagekit/tools/xaenc, see cdrom/build-music.sh). The drive reads the file
+ * in real time mode with the channel filter on, decodes the sectors of the
+ * playing track's channel itself and feeds them to the SPU's CD input: the
+ * music takes no CPU time, no SPU RAM and no voice. The tracks of the file
+ * run in step, so musicSwitch() changes track at the same point of the music
+ * with nothing but a new filter; musicPlay() starts a track from the top.
+ * A track loops by seeking back to the start of the file when it ends.
+ *
+ * The drive does one thing at a time: the music stops while the loader
+ * (loader.h) reads and picks up where it was once the loader is idle. Stop
+ * it with musicStop() before using the blocking archiveLoad().
+ *
+ * The position in the file is counted from the frames gone by, the drive
+ * reading a fixed number of sectors a second, and put right every
+ * MUSIC_POLL frames by asking the drive where it is.
+ */
+
+#ifndef MUSIC_H
+#define MUSIC_H
+
+#include "imagekit/music_tracks.h"
+
+#define MUSIC_FILE "\\MUSIC.XA;1"
+#define MUSIC_NONE -1
+#define MUSIC_POLL 30
+#define MUSIC_SECTOR_RATE (MUSIC_DOUBLE_SPEED ? 150 : 75) // sectors a second
+
+int musicStart;              // first sector of MUSIC.XA, 0 when it is not on the disc
+int musicTrack = MUSIC_NONE; // playing, or waiting for the drive
+int musicStreaming;          // the drive is reading it
+int musicPolling;            // a CdlGetlocP waits for its result
+int musicPosition;           // sectors into the file at musicPositionFrame
+unsigned long musicPositionFrame;
+int musicFrameRate;
+u_char musicResult[8];
+
+// Where the drive should be now, in sectors from the start of the file
+int musicHere() {
+	return musicPosition + (vsyncCount - musicPositionFrame) * MUSIC_SECTOR_RATE / musicFrameRate;
+}
+
+// After archiveInit() (CdInit()) and audioInit(): finds the file and turns
+// the SPU's CD input on
+int musicInit() {
+	CdlFILE file;
+	SpuCommonAttr attr;
+
+	musicStart = 0;
+	musicTrack = MUSIC_NONE;
+	musicStreaming = 0;
+	musicPolling = 0;
+	musicFrameRate = GetVideoMode() == MODE_PAL ? 50 : 60;
+	if (!CdSearchFile(&file, MUSIC_FILE)) {
+		if (DEBUG) printf("%s is not on the disc\n", MUSIC_FILE);
+		return 0;
+	}
+	musicStart = CdPosToInt(&file.pos);
+
+	attr.mask = SPU_COMMON_CDVOLL | SPU_COMMON_CDVOLR | SPU_COMMON_CDMIX;
+	attr.cd.volume.left = 0x7fff;
+	attr.cd.volume.right = 0x7fff;
+	attr.cd.mix = SPU_ON;
+	SpuSetCommonAttr(&attr);
+	return 1;
+}
+
+void musicSetVolume(int volume) {
+	SpuCommonAttr attr;
+	attr.mask = SPU_COMMON_CDVOLL | SPU_COMMON_CDVOLR;
+	attr.cd.volume.left = volume;
+	attr.cd.volume.right = volume;
+	SpuSetCommonAttr(&attr);
+}
+
+void musicFilter() {
+	CdlFILTER filter;
+	filter.file = MUSIC_FILE_NUMBER;
+	filter.chan = musicTrack; // track n is on channel n
+	CdControl(CdlSetfilter, (u_char *)&filter, 0);
+}
+
+// Starts reading at a sector of the file, the first of an interleave
+void musicStream(int position) {
+	CdlLOC loc;
+	u_char mode = CdlModeRT | CdlModeSF | (MUSIC_DOUBLE_SPEED ? CdlModeSpeed : 0);
+
+	position -= position % MUSIC_INTERLEAVE;
+	CdControl(CdlSetmode, &mode, 0);
+	musicFilter();
+	CdIntToPos(musicStart + position, &loc);
+	CdControl(CdlReadS, (u_char *)&loc, 0);
+	musicPosition = position;
+	musicPositionFrame = vsyncCount;
+	musicStreaming = 1;
+	musicPolling = 0;
+}
+
+// Starts a track from the top; with the loader busy it starts once it is done
+void musicPlay(int track) {
+	if (!musicStart || track < 0 || track >= MUSIC_TRACK_COUNT) return;
+	musicTrack = track;
+	musicPosition = 0;
+	musicStreaming = 0;
+	if (loaderIdle()) musicStream(0);
+}
+
+// Carries on with another track from the same point, without a seek
+void musicSwitch(int track) {
+	if (!musicStart || track < 0 || track >= MUSIC_TRACK_COUNT) return;
+	if (musicTrack == MUSIC_NONE) {
+		musicPlay(track);
+		return;
+	}
+	musicTrack = track;
+	if (!musicStreaming) return;
+	musicFilter();
+	musicPolling = 0;
+}
+
+void musicStop() {
+	if (musicStreaming) CdControl(CdlPause, 0, 0);
+	musicTrack = MUSIC_NONE;
+	musicStreaming = 0;
+	musicPolling = 0;
+}
+
+// Once a frame: hands the drive to the loader and takes it back, keeps the
+// position up to date and loops the track
+void musicUpdate() {
+	CdlLOC loc;
+	int result;
+
+	if (musicTrack == MUSIC_NONE) return;
+	if (!loaderIdle()) {
+		// the loader's CdRead() set its own mode, the stream is over
+		if (musicStreaming) musicPosition = musicHere();
+		musicPositionFrame = vsyncCount;
+		musicStreaming = 0;
+		musicPolling = 0;
+		return;
+	}
+	if (!musicStreaming) {
+		musicStream(musicPosition);
+		return;
+	}
+
+	if (musicPolling) {
+		result = CdSync(1, musicResult);
+		if (result == CdlComplete) {
+			// absolute minute, second and sector of the sector under the head
+			loc.minute = musicResult[5];
+			loc.second = musicResult[6];
+			loc.sector = musicResult[7];
+			musicPosition = CdPosToInt(&loc) - musicStart;
+			musicPositionFrame = vsyncCount;
+			musicPolling = 0;
+		} else if (result == CdlDiskError) {
+			musicPositionFrame = vsyncCount;
+			musicPolling = 0;
+		}
+	} else if (vsyncCount - musicPositionFrame >= MUSIC_POLL) {
+		musicPolling = CdControlF(CdlGetlocP, 0);
+	}
+
+	if (musicHere() >= musicTrackLength[musicTrack] * MUSIC_INTERLEAVE) musicStream(0);
+}
+
+#endif
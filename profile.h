@@ -0,0 +1,120 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+// Hot-path profiler. Sections are timed in hsyncs with root counter 1 and
+// summed per frame; every PROFILE_WINDOW frames the min/avg/max of each
+// section are published to profileSections[].min/avg/max. The GPU time comes
+// from the DrawSync callback in constants.h. profileDraw() shows them as bars,
+// one frame long at full width, when profileOverlay is on.
+
+#define PROFILE_UPDATE 0
+#define PROFILE_WAIT 1    // clearDisplay(), mostly waiting for the free buffer
+#define PROFILE_DRAW 2
+#define PROFILE_DISPLAY 3
+#define PROFILE_AUDIO 4   // sound and music upkeep and the soundPlay() calls, inside UPDATE
+#define PROFILE_GPU 5
+#define PROFILE_COUNT 6
+
+#define PROFILE_WINDOW 32 // frames per published min/avg/max
+#define PROFILE_BAR_X 16
+#define PROFILE_BAR_Y 160
+#define PROFILE_BAR_WIDTH 256 // pixels for a whole frame
+#define PROFILE_BAR_HEIGHT 4
+
+typedef struct {
+	char *name;
+	Color color;
+	unsigned short start;  // counter at profileBegin()
+	unsigned short frame;  // hsyncs spent this frame
+	unsigned short low, high;
+	unsigned long sum;     // current window
+	unsigned short min, avg, max; // last complete window
+} ProfileSection;
+
+ProfileSection profileSections[PROFILE_COUNT];
+int profileFrames;
+int profileFrameHsyncs; // hsyncs in one frame (one field, interlaced)
+int profileOverlay;
+
+void profileInit() {
+	int i;
+	char *names[PROFILE_COUNT] = { "UPDATE", "WAIT", "DRAW", "DISPLAY", "AUDIO", "GPU" };
+	Color colors[PROFILE_COUNT] = {
+		{ 0, 255, 0 }, { 96, 96, 96 }, { 255, 255, 0 }, { 255, 128, 0 }, { 0, 255, 255 }, { 255, 0, 255 }
+	};
+	for (i = 0; i < PROFILE_COUNT; i++) {
+		profileSections[i].name = names[i];
+		profileSections[i].color = colors[i];
+		profileSections[i].frame = 0;
+		profileSections[i].low = 0xffff;
+		profileSections[i].high = 0;
+		profileSections[i].sum = 0;
+		profileSections[i].min = profileSections[i].avg = profileSections[i].max = 0;
+	}
+	profileFrames = 0;
+	profileFrameHsyncs = SCREEN_HEIGHT == 256 ? 313 : 263;
+	SetRCnt(RCntCNT1, 0xffff, RCntMdNOINTR);
+	StartRCnt(RCntCNT1);
+}
+
+void profileBegin(int section) {
+	profileSections[section].start = GetRCnt(RCntCNT1);
+}
+
+// Sections may be entered several times a frame, the time adds up
+void profileEnd(int section) {
+	ProfileSection *p = &profileSections[section];
+	p->frame += (GetRCnt(RCntCNT1) - p->start) & 0xffff;
+}
+
+void profileEndFrame() {
+	int i;
+	ProfileSection *p;
+	profileSections[PROFILE_GPU].frame = gpuHsyncs;
+	profileFrames++;
+	for (i = 0; i < PROFILE_COUNT; i++) {
+		p = &profileSections[i];
+		p->sum += p->frame;
+		if (p->frame < p->low) p->low = p->frame;
+		if (p->frame > p->high) p->high = p->frame;
+		p->frame = 0;
+		if (profileFrames == PROFILE_WINDOW) {
+			p->min = p->low;
+			p->avg = p->sum / PROFILE_WINDOW;
+			p->max = p->high;
+			p->low = 0xffff;
+			p->high = 0;
+			p->sum = 0;
+		}
+	}
+	if (profileFrames == PROFILE_WINDOW) profileFrames = 0;
+}
+
+int profileBarWidth(int hsyncs) {
+	return hsyncs * PROFILE_BAR_WIDTH / profileFrameHsyncs;
+}
+
+// One bar per section: the average, with a tick at the maximum. The CPU total
+// (everything but WAIT and GPU) and the GPU are printed as % of the frame.
+void profileDraw() {
+	int i, y, cpu;
+	ProfileSection *p;
+	if (!profileOverlay) return;
+	cpu = 0;
+	for (i = 0; i < PROFILE_COUNT; i++) {
+		p = &profileSections[i];
+		y = PROFILE_BAR_Y + i * (PROFILE_BAR_HEIGHT + 2);
+		drawTile(p->color, PROFILE_BAR_X, y, profileBarWidth(p->avg), PROFILE_BAR_HEIGHT, LAYER_HUD);
+		drawTile(p->color, PROFILE_BAR_X + profileBarWidth(p->max), y, 1, PROFILE_BAR_HEIGHT, LAYER_HUD);
+		if (i != PROFILE_WAIT && i != PROFILE_GPU && i != PROFILE_AUDIO) cpu += p->avg;
+	}
+	// frame boundary
+	drawTile(createColor(255, 255, 255), PROFILE_BAR_X + PROFILE_BAR_WIDTH, PROFILE_BAR_Y, 1, PROFILE_COUNT * (PROFILE_BAR_HEIGHT + 2), LAYER_HUD);
+	FntPrint("CPU %d%% GPU %d%%\n", cpu * 100 / profileFrameHsyncs, profileSections[PROFILE_GPU].avg * 100 / profileFrameHsyncs);
+	for (i = 0; i < PROFILE_COUNT; i++) {
+		p = &profileSections[i];
+		FntPrint("%s %d/%d/%d\n", p->name, p->min, p->avg, p->max);
+	}
+}
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef PROJECTILE_H
+#define PROJECTILE_H
+
+// Projectile pool. Bullets are preallocated and spawned and despawned in O(1)
+// through a free list. projectileUpdate() moves them all, culls the ones that
+// left the screen and tests them against the collision grid;
+// projectileDraw() emits the whole pool as TILEs in one pass.
+
+#define PROJECTILE_MAX 256
+#define PROJECTILE_SIZE 3
+#define PROJECTILE_NONE -1
+
+short projectileX[PROJECTILE_MAX];
+short projectileY[PROJECTILE_MAX];
+short projectileVX[PROJECTILE_MAX];
+short projectileVY[PROJECTILE_MAX];
+short projectileMask[PROJECTILE_MAX]; // COLLIDE_* groups the projectile hits, 0 for a free slot
+short projectileNext[PROJECTILE_MAX]; // free list link
+int   projectileFree;
+int   projectileHigh;                 // one past the highest live slot
+int   projectileCount;
+Color projectileColor;
+
+void projectileInit() {
+	int i;
+	for (i = 0; i < PROJECTILE_MAX; i++) {
+		projectileMask[i] = 0;
+		projectileNext[i] = i + 1;
+	}
+	projectileNext[PROJECTILE_MAX - 1] = PROJECTILE_NONE;
+	projectileFree = 0;
+	projectileHigh = 0;
+	projectileCount = 0;
+	projectileColor = createColor(255, 255, 255);
+}
+
+int projectileSpawn(int x, int y, int speed_x, int speed_y, int mask) {
+	int id = projectileFree;
+	if (id == PROJECTILE_NONE) return PROJECTILE_NONE;
+	projectileFree = projectileNext[id];
+	projectileX[id] = x;
+	projectileY[id] = y;
+	projectileVX[id] = speed_x;
+	projectileVY[id] = speed_y;
+	projectileMask[id] = mask;
+	if (id >= projectileHigh) projectileHigh = id + 1;
+	projectileCount++;
+	return id;
+}
+
+void projectileDespawn(int id) {
+	projectileMask[id] = 0;
+	projectileNext[id] = projectileFree;
+	projectileFree = id;
+	projectileCount--;
+}
+
+// Moves every live projectile and despawns the ones that left the screen or
+// hit an entity in their mask. hit(entity) is called for each hit. Drops
+// projectileHigh past the freed slots at the end, once a frame rather than on
+// every despawn.
+void projectileUpdate(void (*hit)(int entity)) {
+	int i, target;
+	for (i = 0; i < projectileHigh; i++) {
+		if (!projectileMask[i]) continue;
+		projectileX[i] += projectileVX[i];
+		projectileY[i] += projectileVY[i];
+		if (projectileX[i] < -PROJECTILE_SIZE || projectileX[i] >= SCREEN_WIDTH ||
+		    projectileY[i] < -PROJECTILE_SIZE || projectileY[i] >= SCREEN_HEIGHT) {
+			projectileDespawn(i);
+			continue;
+		}
+		target = gridQuery(projectileX[i], projectileY[i], PROJECTILE_SIZE, PROJECTILE_SIZE, projectileMask[i]);
+		if (target != ENTITY_NONE) {
+			projectileDespawn(i);
+			if (hit) hit(target);
+		}
+	}
+	while (projectileHigh > 0 && !projectileMask[projectileHigh - 1]) projectileHigh--;
+}
+
+void projectileDraw() {
+	int i, n;
+	TILE *tile;
+	currentBuffer = GsGetActiveBuff();
+	n = packetReserveBatch(LAYER_BULLETS, sizeof(TILE), projectileCount);
+	tile = (TILE *)GsGetWorkBase();
+	for (i = 0; i < projectileHigh && n > 0; i++) {
+		if (!projectileMask[i]) continue;
+		SetTile(tile);
+		setRGB0(tile, projectileColor.r, projectileColor.g, projectileColor.b);
+		setXY0(tile, projectileX[i], projectileY[i]);
+		setWH(tile, PROJECTILE_SIZE + 1, PROJECTILE_SIZE + 1); // same footprint as the old 4-line outline
+		AddPrim(orderingTable[currentBuffer].org + layerPriority(LAYER_BULLETS, projectileY[i] + PROJECTILE_SIZE), tile);
+		tile++;
+		n--;
+	}
+	GsSetWorkBase((PACKET *)tile);
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef SCRATCHPAD_H
+#define SCRATCHPAD_H
+
+// The 1 KB scratchpad at 0x1f800000 is the R3000's data cache wired up as
+// fast RAM: a load from it takes no extra cycles where one from main RAM
+// stalls the pipeline. scratchAlloc() carves the hottest per-frame arrays out
+// of it at boot, there is no free. DMA cannot reach it, so ordering table
+// buckets, packets and anything else the GPU, CD or SPU read stay in main RAM,
+// as does anything that has to survive code treating the scratchpad as its
+// own work space.
+//
+// An allocation that does not fit falls back to the heap (initializeHeap()
+// has to have run). DEBUG builds report it, keep a guard word after the last
+// allocation and scratchCheck() complains once something wrote over it.
+
+#define SCRATCH_BASE 0x1f800000
+#define SCRATCH_SIZE 1024
+#define SCRATCH_GUARD 0x5c7a7c4d
+
+unsigned char *scratchTop = (unsigned char *)SCRATCH_BASE; // first free byte
+int scratchOverflow;        // bytes that went to the heap instead
+
+// Returns size bytes of zeroed memory, word aligned, from the scratchpad
+// when they fit
+void *scratchAlloc(int size) {
+	void *p;
+	size = (size + 3) & ~3;
+	if (scratchTop + size + (DEBUG ? 4 : 0) > (unsigned char *)SCRATCH_BASE + SCRATCH_SIZE) {
+		scratchOverflow += size;
+		if (DEBUG) printf("Scratchpad full, %d bytes go to the heap\n", size);
+		p = malloc3(size);
+	} else {
+		p = scratchTop;
+		scratchTop += size;
+		if (DEBUG) *(u_long *)scratchTop = SCRATCH_GUARD;
+	}
+	if (p) memset(p, 0, size);
+	return p;
+}
+
+int scratchUsed() {
+	return scratchTop - (unsigned char *)SCRATCH_BASE;
+}
+
+// Once a frame in DEBUG builds: an array written past its end has hit the
+// guard word
+void scratchCheck() {
+	if (!DEBUG || scratchTop == (unsigned char *)SCRATCH_BASE) return;
+	if (*(u_long *)scratchTop == SCRATCH_GUARD) return;
+	printf("Scratchpad overrun past %d bytes\n", scratchUsed());
+	*(u_long *)scratchTop = SCRATCH_GUARD;
+}
+
+#endif
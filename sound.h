@@ -0,0 +1,342 @@
+#ifndef SOUND_H
+#define SOUND_H
+
+// Voice manager. Samples are descriptors of VAG data in SPU RAM, any number of
+// them can play at once: soundPlay() puts a sample on a free voice out of all
+// 24, or takes the one playing the least important sound (the oldest of
+// those) when none is free. A sound loses to nothing more important than
+// itself, so a firefight drops explosions before it drops cues.
+//
+// Sample data gets into SPU RAM through an upload queue: soundUpload() queues
+// a DMA transfer and returns at once, the SPU transfer callback starts the
+// next one as soon as one is done, so a level's sounds go up while the game
+// renders. A sample plays once every upload queued for it has finished
+// (soundReady()); a transfer's done callback runs from soundUpdate(), in the
+// main loop, never from the interrupt.
+//
+// SPU RAM is handed out here too, first fit from a list of blocks sorted by
+// address, so samples can be freed in any order and soundRamStats() can tell
+// how much of it is free and how broken up that is. Sound banks
+// (soundbank.h) load and free whole groups of samples with it.
+
+#define SOUND_VOICES 24
+#define SOUND_SAMPLE_MAX 32
+#define SOUND_NONE -1
+#define SOUND_UPLOAD_MAX 16
+#define SOUND_ADDR_NONE ((unsigned long)-1)
+
+#define SOUND_RAM_SIZE 0x80000  // 512 KB
+#define SOUND_RAM_START 0x1040  // below: the CD and voice capture buffers
+#define SOUND_RAM_ALIGN 64      // DMA writes whole 64 byte blocks
+#define SOUND_BLOCK_MAX 48
+
+// Priorities, higher wins
+#define SOUND_PRIORITY_AMBIENT 0
+#define SOUND_PRIORITY_EFFECT 1
+#define SOUND_PRIORITY_CUE 2
+
+typedef struct {
+	unsigned long spuAddr; // SOUND_ADDR_NONE until loaded
+	int size;
+	short volume;          // 0 to 0x3fff
+	short pitch;           // 0x1000 plays at 44.1 kHz
+	short used;            // 0 once soundFree()d, soundNew() takes it again
+	int uploadsQueued;     // written by soundUpload() only
+	volatile int uploadsDone; // written by the transfer callback only
+} SoundSample;
+
+typedef struct {
+	short sample;          // SOUND_NONE when never used
+	short priority;
+	unsigned long started; // soundClock at key on
+} SoundVoice;
+
+typedef void (*SoundUploadCallback)(void *user);
+
+typedef struct {
+	int sample;            // SOUND_NONE for data that is not a sample's
+	unsigned long spuAddr;
+	unsigned char *data;   // word aligned, left alone until the transfer is done
+	int size;
+	SoundUploadCallback done; // may be NULL
+	void *user;
+} SoundUpload;
+
+typedef struct {
+	unsigned long addr;
+	long size;             // rounded up to SOUND_RAM_ALIGN
+} SoundBlock;
+
+typedef struct {
+	long used;
+	long free;
+	long largest;          // the biggest sample that still fits
+	long fragmented;       // free bytes outside the largest gap
+	int blocks;
+} SoundRamStats;
+
+SoundSample soundSamples[SOUND_SAMPLE_MAX];
+int soundSampleCount;  // slots ever used, freed ones among them
+SoundBlock soundBlocks[SOUND_BLOCK_MAX]; // sorted by address
+int soundBlockCount;
+SoundVoice soundVoices[SOUND_VOICES];
+unsigned long soundClock;
+
+// A ring in transfer order: uploads from head to next are done and wait for
+// soundUpdate(), from next to tail they are in flight or queued
+SoundUpload soundUploads[SOUND_UPLOAD_MAX];
+volatile int soundUploadHead;
+volatile int soundUploadNext;
+volatile int soundUploadTail;
+volatile int soundUploading; // a transfer is in flight
+
+// SPU RAM for size bytes, SOUND_ADDR_NONE when there is no gap that big
+unsigned long soundRamAlloc(long size) {
+	unsigned long addr = SOUND_RAM_START, end;
+	int i;
+	size = (size + SOUND_RAM_ALIGN - 1) & ~(SOUND_RAM_ALIGN - 1);
+	if (soundBlockCount == SOUND_BLOCK_MAX) {
+		if (DEBUG) printf("SPU block table full\n");
+		return SOUND_ADDR_NONE;
+	}
+	for (i = 0; i <= soundBlockCount; i++) {
+		end = i < soundBlockCount ? soundBlocks[i].addr : SOUND_RAM_SIZE;
+		if (end - addr >= size) break;
+		if (i < soundBlockCount) addr = soundBlocks[i].addr + soundBlocks[i].size;
+	}
+	if (i > soundBlockCount) {
+		if (DEBUG) printf("SPU RAM full, no room for %ld bytes\n", size);
+		return SOUND_ADDR_NONE;
+	}
+	memmove(&soundBlocks[i + 1], &soundBlocks[i], (soundBlockCount - i) * sizeof(SoundBlock));
+	soundBlocks[i].addr = addr;
+	soundBlocks[i].size = size;
+	soundBlockCount++;
+	return addr;
+}
+
+void soundRamFree(unsigned long addr) {
+	int i;
+	for (i = 0; i < soundBlockCount; i++) {
+		if (soundBlocks[i].addr != addr) continue;
+		soundBlockCount--;
+		memmove(&soundBlocks[i], &soundBlocks[i + 1], (soundBlockCount - i) * sizeof(SoundBlock));
+		return;
+	}
+}
+
+void soundRamStats(SoundRamStats *stats) {
+	unsigned long addr = SOUND_RAM_START, end;
+	int i;
+	stats->used = 0;
+	stats->largest = 0;
+	for (i = 0; i <= soundBlockCount; i++) {
+		end = i < soundBlockCount ? soundBlocks[i].addr : SOUND_RAM_SIZE;
+		if ((long)(end - addr) > stats->largest) stats->largest = end - addr;
+		if (i == soundBlockCount) break;
+		stats->used += soundBlocks[i].size;
+		addr = soundBlocks[i].addr + soundBlocks[i].size;
+	}
+	stats->free = SOUND_RAM_SIZE - SOUND_RAM_START - stats->used;
+	stats->fragmented = stats->free - stats->largest;
+	stats->blocks = soundBlockCount;
+}
+
+// Starts the upload at next, if any. Only called with no transfer in flight:
+// from the transfer callback, or from soundUpload() when the SPU was idle.
+void soundUploadStart() {
+	SoundUpload *u;
+	if (soundUploadNext == soundUploadTail) {
+		soundUploading = 0;
+		return;
+	}
+	u = &soundUploads[soundUploadNext];
+	soundUploading = 1;
+	SpuSetTransferMode(SpuTransByDMA);
+	SpuSetTransferStartAddr(u->spuAddr);
+	SpuWrite(u->data, u->size);
+}
+
+// SPU transfer callback, runs in the DMA interrupt
+void soundUploadComplete() {
+	SoundUpload *u = &soundUploads[soundUploadNext];
+	if (u->sample != SOUND_NONE) soundSamples[u->sample].uploadsDone++;
+	soundUploadNext = (soundUploadNext + 1) % SOUND_UPLOAD_MAX;
+	soundUploadStart();
+}
+
+// Once a frame: runs the done callbacks of finished uploads and frees their
+// slots
+void soundUpdate() {
+	SoundUpload *u;
+	while (soundUploadHead != soundUploadNext) {
+		u = &soundUploads[soundUploadHead];
+		if (u->done) u->done(u->user);
+		soundUploadHead = (soundUploadHead + 1) % SOUND_UPLOAD_MAX;
+	}
+}
+
+// Queues size bytes of data for spuAddr on behalf of sample (or SOUND_NONE)
+// With the queue full it waits for the oldest upload.
+void soundUpload(int sample, unsigned long spuAddr, unsigned char *data, int size, SoundUploadCallback done, void *user) {
+	SoundUpload *u;
+	int slot;
+	while ((soundUploadTail + 1) % SOUND_UPLOAD_MAX == soundUploadHead) soundUpdate();
+	slot = soundUploadTail;
+	u = &soundUploads[slot];
+	u->sample = sample;
+	u->spuAddr = spuAddr;
+	u->data = data;
+	u->size = size;
+	u->done = done;
+	u->user = user;
+	if (sample != SOUND_NONE) soundSamples[sample].uploadsQueued++;
+	// the callback sees the new upload from here on; if it already went
+	// idle, nothing is in flight and starting it here cannot race it
+	soundUploadTail = (slot + 1) % SOUND_UPLOAD_MAX;
+	if (!soundUploading) soundUploadStart();
+}
+
+// No upload queued or in flight
+int soundUploadIdle() {
+	return soundUploadNext == soundUploadTail;
+}
+
+// Waits for every queued upload, for loading screens and before freeing SPU
+// memory a transfer may still be writing to
+void soundUploadSync() {
+	while (!soundUploadIdle());
+	soundUpdate();
+}
+
+// After audioInit(): every voice gets the same envelope once, a sample only
+// sets its address, volume and pitch when it starts
+void soundInit() {
+	SpuVoiceAttr attr;
+	int i;
+	for (i = 0; i < SOUND_VOICES; i++) soundVoices[i].sample = SOUND_NONE;
+	soundSampleCount = 0;
+	soundBlockCount = 0;
+	soundClock = 0;
+	soundUploadHead = soundUploadNext = soundUploadTail = 0;
+	soundUploading = 0;
+	SpuSetTransferCallback(soundUploadComplete);
+	attr.mask = SPU_VOICE_ADSR_AMODE | SPU_VOICE_ADSR_SMODE | SPU_VOICE_ADSR_RMODE |
+		SPU_VOICE_ADSR_AR | SPU_VOICE_ADSR_DR | SPU_VOICE_ADSR_SR | SPU_VOICE_ADSR_RR | SPU_VOICE_ADSR_SL;
+	attr.voice = SPU_ALLCH;
+	attr.a_mode = SPU_VOICE_LINEARIncN;
+	attr.s_mode = SPU_VOICE_LINEARIncN;
+	attr.r_mode = SPU_VOICE_LINEARDecN;
+	attr.ar = 0x0;
+	attr.dr = 0x0;
+	attr.sr = 0x0;
+	attr.rr = 0x0;
+	attr.sl = 0xf;
+	SpuSetVoiceAttr(&attr);
+}
+
+// A new, not yet loaded sample; SOUND_NONE when the table is full
+int soundNew() {
+	SoundSample *s;
+	int i;
+	for (i = 0; i < soundSampleCount; i++) {
+		if (!soundSamples[i].used) break;
+	}
+	if (i == SOUND_SAMPLE_MAX) return SOUND_NONE;
+	if (i == soundSampleCount) soundSampleCount++;
+	s = &soundSamples[i];
+	s->used = 1;
+	s->spuAddr = SOUND_ADDR_NONE;
+	s->size = 0;
+	s->volume = 0x1fff;
+	s->pitch = 0x1000;
+	s->uploadsQueued = 0;
+	s->uploadsDone = 0;
+	return i;
+}
+
+// Marks the sample as loaded at spuAddr (VAG data without its header); it
+// plays once its uploads are done
+void soundSet(int sample, unsigned long spuAddr, int size) {
+	if (sample < 0 || sample >= soundSampleCount) return;
+	soundSamples[sample].spuAddr = spuAddr;
+	soundSamples[sample].size = size;
+}
+
+// Loaded and every upload for it finished, for callers that poll
+int soundReady(int sample) {
+	SoundSample *s;
+	if (sample < 0 || sample >= soundSampleCount) return 0;
+	s = &soundSamples[sample];
+	return s->used && s->spuAddr != SOUND_ADDR_NONE && s->uploadsDone == s->uploadsQueued;
+}
+
+// Starts a sample, returns the voice or SOUND_NONE when the sample is not
+// ready or every voice plays something more important
+int soundPlay(int sample, int priority) {
+	SoundSample *s;
+	SoundVoice *v;
+	SpuVoiceAttr attr;
+	char status[SOUND_VOICES];
+	int i, best = SOUND_NONE;
+
+	if (!soundReady(sample)) return SOUND_NONE;
+	s = &soundSamples[sample];
+
+	// a voice whose envelope reached 0 is free, a one-shot VAG ends that way
+	SpuGetAllKeysStatus(status);
+	for (i = 0; i < SOUND_VOICES; i++) {
+		if (status[i] == SPU_OFF || status[i] == SPU_ON_ENV_OFF) {
+			best = i;
+			break;
+		}
+	}
+	if (best == SOUND_NONE) {
+		for (i = 0; i < SOUND_VOICES; i++) {
+			v = &soundVoices[i];
+			if (v->priority > priority) continue;
+			if (best == SOUND_NONE || v->priority < soundVoices[best].priority ||
+				(v->priority == soundVoices[best].priority && v->started < soundVoices[best].started)) best = i;
+		}
+		if (best == SOUND_NONE) return SOUND_NONE;
+	}
+
+	v = &soundVoices[best];
+	v->sample = sample;
+	v->priority = priority;
+	v->started = soundClock++;
+	attr.mask = SPU_VOICE_VOLL | SPU_VOICE_VOLR | SPU_VOICE_PITCH | SPU_VOICE_WDSA;
+	attr.voice = 1L << best;
+	attr.volume.left = s->volume;
+	attr.volume.right = s->volume;
+	attr.pitch = s->pitch;
+	attr.addr = s->spuAddr;
+	SpuSetVoiceAttr(&attr);
+	SpuSetKey(SpuOn, 1L << best); // keying a playing voice restarts it
+	return best;
+}
+
+void soundStop(int voice) {
+	if (voice < 0 || voice >= SOUND_VOICES) return;
+	SpuSetKey(SpuOff, 1L << voice);
+}
+
+// Stops the voices playing the sample and gives its SPU RAM and slot back.
+// Its load has to be over (see loaderSync()).
+void soundFree(int sample) {
+	SoundSample *s;
+	int i;
+	if (sample < 0 || sample >= soundSampleCount || !soundSamples[sample].used) return;
+	s = &soundSamples[sample];
+	for (i = 0; i < SOUND_VOICES; i++) {
+		if (soundVoices[i].sample != sample) continue;
+		soundStop(i);
+		soundVoices[i].sample = SOUND_NONE;
+	}
+	while (s->uploadsDone != s->uploadsQueued); // a transfer may still write to it
+	if (s->spuAddr != SOUND_ADDR_NONE) soundRamFree(s->spuAddr);
+	s->spuAddr = SOUND_ADDR_NONE;
+	s->used = 0;
+}
+
+#endif
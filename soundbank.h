@@ -0,0 +1,104 @@
+/*
+ * soundbank.h
+ *
+ * Sound banks: a named group of archive VAGs loaded together, a level's or
+ * the title screen's, and freed together when it is done with. Loading
+ * queues every entry on the loader (loader.h) and gives each a sample handle
+ * (sound.h) straight away, so the game can hold on to them while the data
+ * streams in; soundBankReady() says when all of them play. Freeing a bank
+ * gives back its samples and their SPU RAM, so the next level's bank loads
+ * into the same 512 KB.
+ */
+
+#ifndef SOUNDBANK_H
+#define SOUNDBANK_H
+
+#define SOUND_BANK_MAX 4
+#define SOUND_BANK_SAMPLES 16
+
+typedef struct {
+	char *name;         // NULL when the slot is free
+	int count;
+	short samples[SOUND_BANK_SAMPLES]; // in the order of the entries
+} SoundBank;
+
+SoundBank soundBanks[SOUND_BANK_MAX];
+
+// In DEBUG builds, after a bank came or went
+void soundBankReport(char *what, SoundBank *b) {
+	SoundRamStats stats;
+	if (!DEBUG) return;
+	soundRamStats(&stats);
+	printf("Sound bank %s %s: SPU RAM %ld used, %ld free, %ld of it fragmented, %d blocks\n",
+		b->name, what, stats.used, stats.free, stats.fragmented, stats.blocks);
+}
+
+// Stops and frees every sample of the bank. Waits for the loader first, a
+// load still in flight would write into the freed SPU RAM.
+void soundBankFree(int bank) {
+	SoundBank *b;
+	int i;
+	if (bank < 0 || bank >= SOUND_BANK_MAX || !soundBanks[bank].name) return;
+	b = &soundBanks[bank];
+	loaderSync();
+	soundUploadSync();
+	for (i = 0; i < b->count; i++) soundFree(b->samples[i]);
+	soundBankReport("freed", b);
+	b->name = NULL;
+	b->count = 0;
+}
+
+// Queues count archive entries as the bank name at the loader priority.
+// Returns the bank, or SOUND_NONE when the bank or sample tables or the loader
+// queue are full, or an entry is not in the archive; what was queued by then
+// is waited for and freed again. An entry that fails to load later on leaves
+// a sample that never plays.
+int soundBankLoad(char *name, int *entries, int count, int priority) {
+	SoundBank *b;
+	int i, bank;
+	for (bank = 0; bank < SOUND_BANK_MAX; bank++) {
+		if (!soundBanks[bank].name) break;
+	}
+	if (bank == SOUND_BANK_MAX || count > SOUND_BANK_SAMPLES) return SOUND_NONE;
+	b = &soundBanks[bank];
+	b->name = name;
+	b->count = 0;
+	for (i = 0; i < count; i++) {
+		b->samples[i] = soundNew();
+		if (b->samples[i] == SOUND_NONE) {
+			if (DEBUG) printf("Sound bank %s: sample table full\n", name);
+			break;
+		}
+		b->count++;
+		if (loaderLoadSound(entries[i], priority, b->samples[i], NULL) < 0) {
+			if (DEBUG) printf("Sound bank %s: cannot queue entry %d\n", name, entries[i]);
+			break;
+		}
+	}
+	if (i < count) {
+		soundBankFree(bank);
+		return SOUND_NONE;
+	}
+	return bank;
+}
+
+// Sample handle of the bank's index-th entry, for soundPlay()
+int soundBankSample(int bank, int index) {
+	if (bank < 0 || bank >= SOUND_BANK_MAX || !soundBanks[bank].name) return SOUND_NONE;
+	if (index < 0 || index >= soundBanks[bank].count) return SOUND_NONE;
+	return soundBanks[bank].samples[index];
+}
+
+// Every sample of the bank loaded and uploaded
+int soundBankReady(int bank) {
+	SoundBank *b;
+	int i;
+	if (bank < 0 || bank >= SOUND_BANK_MAX || !soundBanks[bank].name) return 0;
+	b = &soundBanks[bank];
+	for (i = 0; i < b->count; i++) {
+		if (!soundReady(b->samples[i])) return 0;
+	}
+	return 1;
+}
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+// HUD text drawn with the PIXELSPRITEFONT32 atlas: 5 columns x 13 rows of
+// 32x32 glyphs, 8-bit. The atlas is 416 lines, more than a texture page, so
+// it is uploaded as two textures of 8 and 5 glyph rows. Each Text keeps its
+// glyph SPRTs between frames and only rebuilds them when the string changes,
+// so drawing an unchanged string is just linking the primitives into the
+// ordering table. There is a copy per buffer since the GPU may still be
+// walking last frame's chain.
+
+#define FONT_GLYPH_SIZE 32
+#define FONT_COLUMNS 5
+#define FONT_PAGE_ROWS 8 // glyph rows per 256-line texture page
+#define FONT_ADVANCE 24  // the glyphs leave about 4 pixels of air on each side
+#define FONT_GLYPHS "ABCDEFGHIJKLMNOPQRSTUVWXYZ1234567890.,/<>(){}[]?!      -+_=*^%#@$"
+#define TEXT_MAX 24
+
+typedef struct {
+	char text[TEXT_MAX + 1];
+	int x, y;
+	int length;                 // glyphs in sprt[]
+	int pageSplit;              // glyphs [0, pageSplit) are on the first texture page
+	int dirty[2];               // sprt[buffer] needs rebuilding
+	int value;                  // last number given to textSetInt()
+	SPRT sprt[2][TEXT_MAX];
+	DR_TPAGE tpage[2][2];
+	short glyph[TEXT_MAX];      // glyphs sorted by texture page
+	short glyphX[TEXT_MAX];
+} Text;
+
+signed char fontGlyph[128]; // atlas index per ASCII character, -1 when missing
+Texture fontPage[2];
+
+// data points at the atlas TIM (ASSET_FONT in the archive)
+void fontInit(unsigned char *data) {
+	int i, rows = FONT_PAGE_ROWS * FONT_GLYPH_SIZE;
+	GsIMAGE tim;
+	char *glyphs = FONT_GLYPHS;
+
+	GsGetTimInfo((u_long *)(data + 4), &tim);
+	textureLoadRows(&tim, 0, rows, &fontPage[0]);
+	tim.pmode &= ~8; // the second half shares the first one's CLUT
+	textureLoadRows(&tim, rows, tim.ph - rows, &fontPage[1]);
+	fontPage[1].clut = fontPage[0].clut;
+
+	for (i = 0; i < 128; i++) fontGlyph[i] = -1;
+	for (i = 0; glyphs[i]; i++) {
+		if (glyphs[i] != ' ') fontGlyph[(int)glyphs[i]] = i;
+	}
+	for (i = 'a'; i <= 'z'; i++) fontGlyph[i] = fontGlyph[i - 'a' + 'A'];
+}
+
+void textInit(Text *t, int x, int y) {
+	t->text[0] = 0;
+	t->x = x;
+	t->y = y;
+	t->length = 0;
+	t->pageSplit = 0;
+	t->dirty[0] = t->dirty[1] = 0;
+	t->value = 0x7fffffff;
+}
+
+// Lays the string out into glyph indices, the SPRTs are filled in by textDraw()
+void textSet(Text *t, char *string) {
+	int i, x, g, n, page;
+	for (i = 0; string[i] && i < TEXT_MAX; i++) {
+		if (t->text[i] != string[i]) break;
+	}
+	if (t->text[i] == string[i] || i == TEXT_MAX) return;
+
+	for (i = 0; string[i] && i < TEXT_MAX; i++) t->text[i] = string[i];
+	t->text[i] = 0;
+
+	// first texture page glyphs first, so each page needs one DR_TPAGE
+	n = 0;
+	for (page = 0; page < 2; page++) {
+		if (page == 1) t->pageSplit = n;
+		x = 0;
+		for (i = 0; t->text[i]; i++, x += FONT_ADVANCE) {
+			g = (t->text[i] & 0x80) ? -1 : fontGlyph[(int)t->text[i]];
+			if (g < 0 || (g / FONT_COLUMNS >= FONT_PAGE_ROWS) != page) continue;
+			t->glyph[n] = g;
+			t->glyphX[n] = x;
+			n++;
+		}
+	}
+	t->length = n;
+	t->dirty[0] = t->dirty[1] = 1;
+}
+
+// Writes the number in decimal after prefix, skipped when the value is unchanged
+void textSetInt(Text *t, char *prefix, int value) {
+	char string[TEXT_MAX + 1], digits[12];
+	int i = 0, n = 0;
+	unsigned int v = value < 0 ? -value : value;
+	if (value == t->value) return;
+	t->value = value;
+	while (prefix[i] && i < TEXT_MAX) {
+		string[i] = prefix[i];
+		i++;
+	}
+	do {
+		digits[n++] = '0' + v % 10;
+		v /= 10;
+	} while (v);
+	if (value < 0) digits[n++] = '-';
+	while (n && i < TEXT_MAX) string[i++] = digits[--n];
+	string[i] = 0;
+	textSet(t, string);
+}
+
+void textBuild(Text *t, int buffer) {
+	int i, g;
+	SPRT *p;
+	Texture *page;
+	for (i = 0; i < t->length; i++) {
+		g = t->glyph[i];
+		page = &fontPage[i >= t->pageSplit];
+		p = &t->sprt[buffer][i];
+		SetSprt(p);
+		setRGB0(p, 128, 128, 128);
+		setXY0(p, t->x + t->glyphX[i], t->y);
+		setUV0(p, page->u + (g % FONT_COLUMNS) * FONT_GLYPH_SIZE, page->v + ((g / FONT_COLUMNS) % FONT_PAGE_ROWS) * FONT_GLYPH_SIZE);
+		setWH(p, FONT_GLYPH_SIZE, FONT_GLYPH_SIZE);
+		p->clut = page->clut;
+	}
+	SetDrawTPage(&t->tpage[buffer][0], 1, 0, fontPage[0].tpage);
+	SetDrawTPage(&t->tpage[buffer][1], 1, 0, fontPage[1].tpage);
+	t->dirty[buffer] = 0;
+}
+
+// Links the glyphs into the layer's bucket. AddPrim puts primitives at the
+// head of the bucket, so each page goes in glyphs first, DR_TPAGE last.
+void textDraw(Text *t, int layer) {
+	int i;
+	GsOT_TAG *bucket;
+	currentBuffer = GsGetActiveBuff();
+	if (!t->length) return;
+	if (t->dirty[currentBuffer]) textBuild(t, currentBuffer);
+	bucket = orderingTable[currentBuffer].org + layerPriority(layer, t->y + FONT_GLYPH_SIZE);
+	if (t->pageSplit < t->length) {
+		for (i = t->pageSplit; i < t->length; i++) AddPrim(bucket, &t->sprt[currentBuffer][i]);
+		AddPrim(bucket, &t->tpage[currentBuffer][1]);
+	}
+	if (t->pageSplit > 0) {
+		for (i = 0; i < t->pageSplit; i++) AddPrim(bucket, &t->sprt[currentBuffer][i]);
+		AddPrim(bucket, &t->tpage[currentBuffer][0]);
+	}
+}
+
+#endif
@@ -0,0 +1,293 @@
+#ifndef VRAM_H
+#define VRAM_H
+
+// VRAM allocator. Keeps the list of used rectangles of the 1024x512 frame
+// buffer (in 16-bit VRAM pixels) and places textures and CLUTs in the gaps.
+// Textures are kept inside one texture page window so u/v never wrap, CLUTs
+// on 16 pixel boundaries. Every block carries the tag that was current when
+// it was allocated, so a whole level can be released with vramFreeTag().
+// The images packed at build time by imagekit/tools/vrampack are listed in
+// vram_layout.h; their areas are reserved up front and a TIM that sits in
+// one is loaded at its own coordinates without searching. A CLUT that has to
+// be allocated is shared with an identical one of the same tag, counted so it
+// goes when its last texture does.
+
+#include "imagekit/vram_layout.h"
+
+#define VRAM_WIDTH 1024
+#define VRAM_HEIGHT 512
+#define VRAM_BLOCK_MAX 64
+#define VRAM_NONE -1
+#define VRAM_PLACED -2 // block handle of a texture loaded into its vram_layout.h area
+
+#define VRAM_4BIT 0  // texture modes, as in GetTPage()
+#define VRAM_8BIT 1
+#define VRAM_16BIT 2
+#define VRAM_CLUT -1
+
+#define VRAM_TAG_FREE 0
+#define VRAM_TAG_SYSTEM 1 // frame buffers, debug font
+#define VRAM_TAG_GAME 2   // default, lives until reset
+#define VRAM_TAG_LAYOUT 3 // placed at build time, see vram_layout.h
+
+typedef struct {
+	short x, y, w, h;
+	short tag;
+	short refs;         // textures using the block
+	unsigned long hash; // of a CLUT's colours, 0 for anything else
+} VramBlock;
+
+#define TIM_SPRITE_MAGIC 0x54525053 // "SPRT"
+
+// Block imagekit/tools/assetc puts after the pixel data of its TIMs: the
+// image was cropped to its opaque part, w x h at trimX, trimY in the source
+// image, and the pivot is relative to that part
+typedef struct {
+	u_long magic;
+	short sourceW, sourceH;
+	short trimX, trimY;
+	short w, h;
+	short pivotX, pivotY;
+} TimSprite;
+
+typedef struct {
+	unsigned short tpage;
+	unsigned short clut;
+	unsigned char u, v;
+	short w, h;     // in texels
+	short mode;     // VRAM_4BIT, VRAM_8BIT or VRAM_16BIT
+	short block;    // pixel block
+	short clutBlock;
+	short px, py;   // pixel block position in VRAM
+	short cx, cy;   // CLUT position in VRAM
+} Texture;
+
+VramBlock vramBlocks[VRAM_BLOCK_MAX];
+int       vramTag = VRAM_TAG_GAME; // tag given to new blocks
+
+void vramSetTag(int tag) {
+	vramTag = tag;
+}
+
+int vramOverlaps(int x, int y, int w, int h) {
+	int i;
+	VramBlock *b;
+	for (i = 0; i < VRAM_BLOCK_MAX; i++) {
+		b = &vramBlocks[i];
+		if (b->tag == VRAM_TAG_FREE) continue;
+		if (x < b->x + b->w && b->x < x + w && y < b->y + b->h && b->y < y + h) return 1;
+	}
+	return 0;
+}
+
+// Whether a w x h block at x, y suits the mode: textures may not leave the
+// 256x256 texel window of their texture page, CLUTs must be 16 aligned
+int vramFits(int x, int y, int w, int h, int mode) {
+	if (x < 0 || y < 0 || x + w > VRAM_WIDTH || y + h > VRAM_HEIGHT) return 0;
+	if (mode == VRAM_CLUT) return (x & 15) == 0;
+	return (x & 63) + w <= (64 << mode) && (y & 255) + h <= 256;
+}
+
+int vramAddBlock(int x, int y, int w, int h, int tag) {
+	int i;
+	for (i = 0; i < VRAM_BLOCK_MAX; i++) {
+		if (vramBlocks[i].tag != VRAM_TAG_FREE) continue;
+		vramBlocks[i].x = x;
+		vramBlocks[i].y = y;
+		vramBlocks[i].w = w;
+		vramBlocks[i].h = h;
+		vramBlocks[i].tag = tag;
+		vramBlocks[i].refs = 1;
+		vramBlocks[i].hash = 0;
+		return i;
+	}
+	if (DEBUG) printf("VRAM block table full\n");
+	return VRAM_NONE;
+}
+
+void vramInit() {
+	int i;
+	for (i = 0; i < VRAM_BLOCK_MAX; i++) vramBlocks[i].tag = VRAM_TAG_FREE;
+	for (i = 0; i < VRAM_LAYOUT_COUNT; i++) {
+		vramAddBlock(vramLayout[i][0], vramLayout[i][1], vramLayout[i][2], vramLayout[i][3], VRAM_TAG_LAYOUT);
+	}
+	vramTag = VRAM_TAG_GAME;
+}
+
+// Marks an area as used by the system (frame buffers, fonts)
+int vramReserve(int x, int y, int w, int h) {
+	return vramAddBlock(x, y, w, h, VRAM_TAG_SYSTEM);
+}
+
+// Finds room for a w x h block (VRAM pixels). The candidate corners are the
+// origin, the edges of the existing blocks and the texture page boundaries.
+// Textures take the topmost, then leftmost, free spot; CLUTs stack up from the
+// bottom of VRAM so their long thin rows don't cut through texture space.
+int vramAlloc(int w, int h, int mode, RECT *rect) {
+	int i, j, x, y, bestX = -1, bestY = -1;
+	short xs[VRAM_BLOCK_MAX + 16], ys[2 * VRAM_BLOCK_MAX + 3];
+	int nx = 0, ny = 0;
+	VramBlock *b;
+
+	for (x = 0; x < VRAM_WIDTH; x += 64) xs[nx++] = x;
+	ys[ny++] = 0;
+	ys[ny++] = 256;
+	ys[ny++] = VRAM_HEIGHT - h;
+	for (i = 0; i < VRAM_BLOCK_MAX; i++) {
+		b = &vramBlocks[i];
+		if (b->tag == VRAM_TAG_FREE) continue;
+		x = b->x + b->w;
+		if (mode == VRAM_CLUT) x = (x + 15) & ~15;
+		if (x & 63) xs[nx++] = x;
+		ys[ny++] = b->y + b->h;
+		ys[ny++] = b->y - h;
+	}
+
+	for (j = 0; j < ny; j++) {
+		y = ys[j];
+		if (bestX >= 0 && (mode == VRAM_CLUT ? y < bestY : y > bestY)) continue;
+		for (i = 0; i < nx; i++) {
+			x = xs[i];
+			if (bestX >= 0 && y == bestY && x >= bestX) continue;
+			if (!vramFits(x, y, w, h, mode) || vramOverlaps(x, y, w, h)) continue;
+			bestX = x;
+			bestY = y;
+		}
+	}
+	if (bestX < 0) {
+		if (DEBUG) printf("VRAM full, no room for %dx%d\n", w, h);
+		return VRAM_NONE;
+	}
+	setRECT(rect, bestX, bestY, w, h);
+	return vramAddBlock(bestX, bestY, w, h, vramTag);
+}
+
+// Whether the rectangle lies in an area packed at build time
+int vramInLayout(int x, int y, int w, int h) {
+	int i;
+	VramBlock *b;
+	for (i = 0; i < VRAM_BLOCK_MAX; i++) {
+		b = &vramBlocks[i];
+		if (b->tag != VRAM_TAG_LAYOUT) continue;
+		if (x >= b->x && y >= b->y && x + w <= b->x + b->w && y + h <= b->y + b->h) return 1;
+	}
+	return 0;
+}
+
+// Takes the TIM's own position when the packer put it there, otherwise asks
+// the allocator. Placed areas belong to the layout and come back as VRAM_PLACED.
+int vramPlace(int x, int y, int w, int h, int mode, RECT *rect) {
+	if (vramInLayout(x, y, w, h)) {
+		setRECT(rect, x, y, w, h);
+		return VRAM_PLACED;
+	}
+	return vramAlloc(w, h, mode, rect);
+}
+
+void vramFree(int block) {
+	if (block >= 0 && --vramBlocks[block].refs <= 0) vramBlocks[block].tag = VRAM_TAG_FREE;
+}
+
+unsigned long vramClutHash(u_long *clut, int words) {
+	unsigned long hash = 2166136261u;
+	while (words--) hash = (hash ^ *clut++) * 16777619u;
+	return hash | 1; // never 0
+}
+
+// An allocated CLUT of the same size and colours, or VRAM_NONE. Only blocks of
+// the current tag qualify: vramFreeTag() drops a tag's blocks whatever their
+// refs, so a CLUT shared across tags would go from under the other textures.
+int vramFindClut(int w, int h, unsigned long hash) {
+	int i;
+	VramBlock *b;
+	for (i = 0; i < VRAM_BLOCK_MAX; i++) {
+		b = &vramBlocks[i];
+		if (b->tag == vramTag && b->hash == hash && b->w == w && b->h == h) return i;
+	}
+	return VRAM_NONE;
+}
+
+// Releases every block allocated under tag, e.g. when a level unloads. Refs
+// don't matter here, CLUTs are only shared within a tag.
+void vramFreeTag(int tag) {
+	int i;
+	for (i = 0; i < VRAM_BLOCK_MAX; i++) {
+		if (vramBlocks[i].tag == tag) vramBlocks[i].tag = VRAM_TAG_FREE;
+	}
+}
+
+// Uploads a rows-line slice of a TIM image (starting at line first) and its
+// CLUT, at the packed position or wherever there is room, and fills in the
+// texture page, u/v and CLUT the GPU needs to draw it. Returns 0 with no VRAM
+// held when either does not fit.
+int textureLoadRows(GsIMAGE *tim, int first, int rows, Texture *tex) {
+	RECT rect;
+	VramBlock *b;
+	unsigned long hash;
+	tex->mode = tim->pmode & 3;
+	tex->clutBlock = VRAM_NONE;
+	tex->block = vramPlace(tim->px, tim->py + first, tim->pw, rows, tex->mode, &rect);
+	if (tex->block == VRAM_NONE) return 0;
+	LoadImage(&rect, (u_long *)((u_char *)tim->pixel + first * tim->pw * 2));
+	tex->px = rect.x;
+	tex->py = rect.y;
+	tex->w = tim->pw << (2 - tex->mode);
+	tex->h = rows;
+	tex->tpage = GetTPage(tex->mode, 1, rect.x, rect.y);
+	tex->u = (rect.x & 63) << (2 - tex->mode);
+	tex->v = rect.y & 255;
+	tex->clut = 0;
+	if (tex->mode == VRAM_16BIT || !(tim->pmode & 8)) return 1;
+
+	hash = vramClutHash(tim->clut, tim->cw * tim->ch / 2);
+	tex->clutBlock = vramInLayout(tim->cx, tim->cy, tim->cw, tim->ch) ? VRAM_NONE : vramFindClut(tim->cw, tim->ch, hash);
+	if (tex->clutBlock != VRAM_NONE) {
+		b = &vramBlocks[tex->clutBlock];
+		b->refs++;
+		setRECT(&rect, b->x, b->y, b->w, b->h);
+	} else {
+		tex->clutBlock = vramPlace(tim->cx, tim->cy, tim->cw, tim->ch, VRAM_CLUT, &rect);
+		if (tex->clutBlock == VRAM_NONE) {
+			vramFree(tex->block);
+			tex->block = VRAM_NONE;
+			return 0;
+		}
+		if (tex->clutBlock >= 0) vramBlocks[tex->clutBlock].hash = hash;
+		LoadImage(&rect, tim->clut);
+	}
+	tex->cx = rect.x;
+	tex->cy = rect.y;
+	tex->clut = GetClut(rect.x, rect.y);
+	return 1;
+}
+
+// data points at a TIM file (starting with its 0x10 magic word)
+int textureLoad(unsigned char *data, Texture *tex) {
+	GsIMAGE tim;
+	GsGetTimInfo((u_long *)(data + 4), &tim);
+	return textureLoadRows(&tim, 0, tim.ph, tex);
+}
+
+// The sprite block of a TIM file of size bytes, NULL for TIMs made by other
+// tools, which end with their pixels, and when the size is not known (0)
+TimSprite *timSprite(unsigned char *data, unsigned long size) {
+	unsigned long offset = 8, length;
+	TimSprite *info;
+	if (size < offset) return NULL;
+	if (((u_long *)data)[1] & 8) { // past the CLUT
+		if (size - offset < 4 || (length = *(u_long *)(data + offset)) > size - offset) return NULL;
+		offset += length;
+	}
+	if (size - offset < 4 || (length = *(u_long *)(data + offset)) > size - offset) return NULL;
+	offset += length; // past the pixels
+	if (size - offset < sizeof(TimSprite)) return NULL;
+	info = (TimSprite *)(data + offset);
+	return info->magic == TIM_SPRITE_MAGIC ? info : NULL;
+}
+
+void textureFree(Texture *tex) {
+	vramFree(tex->block);
+	vramFree(tex->clutBlock);
+}
+
+#endif